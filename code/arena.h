@@ -0,0 +1,91 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+
+// ArenaDeleter destroys an object that lives in a CommandArena
+struct ArenaDeleter {
+  template <typename U>
+  void operator()(U* object) const {
+    object->~U();
+  }
+};
+
+// CommandArena is a monotonic arena for the objects built while a script is
+// parsed: tokens, names and the commands themselves. Allocation is a pointer
+// bump, and release() frees everything at once while keeping the initial
+// buffer, so a line that fits into it does not touch the heap
+class CommandArena {
+ public:
+  static const size_t kInitialSize = 4096;
+
+  CommandArena() : resource(buffer, sizeof(buffer)) {}
+  CommandArena(const CommandArena&) = delete;
+  CommandArena& operator=(const CommandArena&) = delete;
+
+  pmr::memory_resource* memory() { return &resource; }
+
+  // Function to construct an object in the arena. The object is destroyed,
+  // but its memory is not freed, when the returned pointer goes away
+  template <typename U, typename... Args>
+  unique_ptr<U, ArenaDeleter> make(Args&&... args);
+
+  // Function to free every object of the arena. Objects that are still alive
+  // must not be used afterwards
+  void release() { resource.release(); }
+
+ private:
+  alignas(max_align_t) char buffer[kInitialSize];
+  pmr::monotonic_buffer_resource resource;
+};
+
+template <typename U, typename... Args>
+unique_ptr<U, ArenaDeleter> CommandArena::make(Args&&... args) {
+  void* memory = resource.allocate(sizeof(U), alignof(U));
+  return unique_ptr<U, ArenaDeleter>(new (memory) U(forward<Args>(args)...));
+}
+
+// CommandArgs is a view of the argument tokens of a command
+class CommandArgs {
+ public:
+  CommandArgs(const string_view* first, size_t count)
+      : first(first), count(count) {}
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const string_view& operator[](size_t index) const { return first[index]; }
+  const string_view* begin() const { return first; }
+  const string_view* end() const { return first + count; }
+
+  // Returns the arguments from the given index on
+  CommandArgs from(size_t index) const {
+    return CommandArgs(first + index, count - index);
+  }
+
+ private:
+  const string_view* first;
+  size_t count;
+};
+
+// Function to split a line into whitespace separated tokens, which are views
+// into the line
+template <typename Tokens>
+void tokenizeCommand(string_view line, Tokens& tokens) {
+  const char* kSpaces = " \t\n\v\f\r";
+  size_t start = line.find_first_not_of(kSpaces);
+  while (start != string_view::npos) {
+    size_t end = line.find_first_of(kSpaces, start);
+    if (end == string_view::npos) end = line.size();
+    tokens.push_back(line.substr(start, end - start));
+    start = line.find_first_not_of(kSpaces, end);
+  }
+}
+
+#endif
@@ -0,0 +1,51 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../structures/array.h"
+
+using namespace std;
+
+// Benchmark of clustered edits: a cursor walks slowly through an array and
+// every step inserts or removes at the cursor, as in a text editor. The
+// shifting mode moves every element after the cursor, the gap buffer mode
+// only the elements the cursor passes
+
+// Function to run the edits and return the elapsed time in milliseconds
+template <typename T>
+double runEdits(Array<T>& array, int edits, const T& value) {
+  auto start = chrono::steady_clock::now();
+  int cursor = array.getSize() / 2;
+  for (int i = 0; i < edits; i++) {
+    if (i % 64 == 0) cursor = (cursor + 97) % (array.getSize() + 1);
+    if (i % 4 == 3 && cursor > 0) {
+      array.removeAtIndex(--cursor);
+    } else {
+      array.insert(cursor++, value);
+    }
+  }
+  chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+template <typename T>
+void compare(const char* name, int elements, int edits, const T& value) {
+  Array<T> shifting;
+  for (int i = 0; i < elements; i++) shifting.add(value);
+  Array<T> gapped(shifting);
+  gapped.setGapBufferTrue();
+
+  double shiftingTime = runEdits(shifting, edits, value);
+  double gappedTime = runEdits(gapped, edits, value);
+  printf("%-8s %9d elements %8d edits: ", name, elements, edits);
+  printf("shifting %9.2f ms, gap buffer %7.2f ms\n", shiftingTime, gappedTime);
+}
+
+int main(int argc, char* argv[]) {
+  int elements = argc > 1 ? atoi(argv[1]) : 1000000;
+  int edits = argc > 2 ? atoi(argv[2]) : 20000;
+
+  compare<int>("int", elements, edits, 42);
+  compare<string>("string", elements / 10, edits, string("value"));
+  return 0;
+}
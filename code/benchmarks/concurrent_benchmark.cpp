@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../structures/concurrent_hash.h"
+#include "../structures/hash.h"
+
+using namespace std;
+
+// Benchmark of a read-mostly workload on many threads: every thread looks up
+// random keys of a filled table and sets one in every writeEvery operations.
+// A HashTable behind one mutex, the way it has to be shared, is compared
+// with ConcurrentHashTable for 1, 2, 4, ... threads
+
+// HashTable shared behind a single mutex
+class LockedHashTable {
+ public:
+  explicit LockedHashTable(int capacity) : table(capacity) {}
+
+  void set(const string& key, const string& value) {
+    lock_guard<mutex> guard(lock);
+    table.set(key, value);
+  }
+
+  bool find(const string& key, string& value) {
+    lock_guard<mutex> guard(lock);
+    const string* found = table.find(key);
+    if (found != nullptr) value = *found;
+    return found != nullptr;
+  }
+
+ private:
+  mutex lock;
+  HashTable table;
+};
+
+// Function to run the workload and return millions of operations per second
+template <typename Table>
+double run(Table& table, const vector<string>& keys, int threads,
+           int operations, int writeEvery) {
+  vector<thread> workers;
+  auto start = chrono::steady_clock::now();
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      uint64_t random = 0x9E3779B97F4A7C15ull * (t + 1);
+      string value;
+      size_t found = 0;
+      for (int i = 0; i < operations; i++) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        const string& key = keys[random % keys.size()];
+        if (i % writeEvery == 0) {
+          table.set(key, key);
+        } else {
+          found += table.find(key, value);
+        }
+      }
+      if (found == 0) printf("no keys found\n");
+    });
+  }
+  for (thread& worker : workers) worker.join();
+  chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+  return double(threads) * operations / elapsed.count();
+}
+
+int main(int argc, char* argv[]) {
+  int keyCount = argc > 1 ? atoi(argv[1]) : 1000000;
+  int maxThreads = argc > 2 ? atoi(argv[2]) : thread::hardware_concurrency();
+  int operations = 1000000;
+  int writeEvery = 20;
+
+  vector<string> keys;
+  for (int i = 0; i < keyCount; i++) keys.push_back("key" + to_string(i));
+  LockedHashTable locked(keyCount);
+  ConcurrentHashTable concurrent(keyCount);
+  for (const string& key : keys) {
+    locked.set(key, key);
+    concurrent.set(key, key);
+  }
+
+  printf("%d keys, %d%% writes, %d operations per thread\n", keyCount,
+         100 / writeEvery, operations);
+  for (int threads = 1; threads <= maxThreads; threads *= 2) {
+    double lockedRate = run(locked, keys, threads, operations, writeEvery);
+    double concurrentRate =
+        run(concurrent, keys, threads, operations, writeEvery);
+    printf("%3d threads: mutex %7.2f Mops/s, concurrent %7.2f Mops/s\n",
+           threads, lockedRate, concurrentRate);
+  }
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../structures/flat_hash.h"
+#include "../structures/hash.h"
+
+using namespace std;
+
+// Benchmark of HashTable buckets for realistic key sets. For every set it
+// prints the chain lengths that the byte-sum hash HashTable used before and
+// wyhash produce, and the time of find() on a chained and on a flat table
+// filled with the keys. Then it grows a table from 100 buckets and prints
+// the latency percentiles of set()
+
+vector<string> uuids(int count, mt19937_64& random) {
+  vector<string> keys;
+  char buffer[40];
+  for (int i = 0; i < count; i++) {
+    uint64_t high = random(), low = random();
+    snprintf(buffer, sizeof(buffer), "%08x-%04x-4%03x-%04x-%012llx",
+             unsigned(high >> 32), unsigned(high >> 16) & 0xffff,
+             unsigned(high) & 0xfff, unsigned(low >> 48) | 0x8000,
+             (unsigned long long)(low & 0xffffffffffffull));
+    keys.push_back(buffer);
+  }
+  return keys;
+}
+
+vector<string> sequentialIds(int count) {
+  vector<string> keys;
+  for (int i = 0; i < count; i++) keys.push_back("user" + to_string(i));
+  return keys;
+}
+
+// Words of 3 to 10 lowercase letters, with duplicates removed
+vector<string> words(int count, mt19937_64& random) {
+  vector<string> keys;
+  while (int(keys.size()) < count) {
+    string word(3 + random() % 8, ' ');
+    for (char& letter : word) letter = char('a' + random() % 26);
+    keys.push_back(word);
+    if (int(keys.size()) == count) {
+      sort(keys.begin(), keys.end());
+      keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    }
+  }
+  return keys;
+}
+
+int byteSum(const string& key, int buckets) {
+  int sum = 0;
+  for (char letter : key) sum += letter;
+  return sum % buckets;
+}
+
+// Function to print the bucket usage, the longest chain and the average
+// number of keys compared by a successful lookup
+void printChains(const char* hash, const vector<int>& chains, int keys) {
+  int used = 0, longest = 0;
+  double compared = 0;
+  for (int length : chains) {
+    if (length > 0) used++;
+    longest = max(longest, length);
+    compared += length * (length + 1) / 2.0;
+  }
+  printf("  %-8s buckets used %7d  longest chain %6d  keys compared %8.2f\n",
+         hash, used, longest, compared / keys);
+}
+
+// Function to return the time of find() per key in nanoseconds
+template <typename Table>
+double timeFinds(const Table& table, const vector<string>& keys) {
+  vector<string> order(keys);
+  shuffle(order.begin(), order.end(), mt19937_64(1));
+  size_t found = 0;
+  auto start = chrono::steady_clock::now();
+  for (const string& key : order) found += table.find(key)->size();
+  chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+  if (found == 0) printf("  no keys found\n");
+  return elapsed.count() / keys.size();
+}
+
+void run(const char* name, const vector<string>& keys) {
+  int buckets = int(keys.size());
+  HashTable table(buckets);
+  FlatHashTable flat(buckets);
+  vector<int> sumChains(buckets), wyChains(buckets);
+  for (const string& key : keys) {
+    sumChains[byteSum(key, buckets)]++;
+    wyChains[table.hash_calc(key)]++;
+    table.set(key, key);
+    flat.set(key, key);
+  }
+
+  printf("%s (%d keys, %d buckets)\n", name, int(keys.size()), buckets);
+  printChains("byte sum", sumChains, int(keys.size()));
+  printChains("wyhash", wyChains, int(keys.size()));
+  printf("  find: chained %.1f ns per key, flat %.1f ns per key\n",
+         timeFinds(table, keys), timeFinds(flat, keys));
+}
+
+void growth(const vector<string>& keys) {
+  HashTable table;
+  vector<double> latencies;
+  latencies.reserve(keys.size());
+  for (const string& key : keys) {
+    auto start = chrono::steady_clock::now();
+    table.set(key, key);
+    chrono::duration<double, nano> elapsed =
+        chrono::steady_clock::now() - start;
+    latencies.push_back(elapsed.count());
+  }
+  sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) {
+    return latencies[size_t(p * (latencies.size() - 1))];
+  };
+  printf("growth to %d keys (%d buckets)\n", int(keys.size()),
+         table.getCapacity());
+  printf("  set p50 %.0f ns  p99 %.0f ns  p99.99 %.0f ns  max %.0f ns\n",
+         percentile(0.5), percentile(0.99), percentile(0.9999),
+         latencies.back());
+}
+
+int main(int argc, char* argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 100000;
+  mt19937_64 random(2024);
+
+  run("uuids", uuids(count, random));
+  run("sequential ids", sequentialIds(count));
+  run("words", words(count, random));
+  growth(sequentialIds(count * 10));
+  return 0;
+}
@@ -1,65 +1,280 @@
 #include "calculator.h"
+
+#include "parallel.h"
+#include "server.h"
+#include "snapshot.h"
 using namespace std;
 
+// RunOptions holds the leading command line options shared by every mode
+struct RunOptions {
+  ExecutionLimits limits;
+  Tracer* tracer = nullptr;
+  size_t threads = 1;  // Threads that evaluate a script file
+  Checkpointer* checkpointer = nullptr;  // Snapshots the context if set
+  ResultWriter* results = nullptr;       // Binary PRINT output if set
+};
+
+template <typename T>
+void executeCommandsFromFile(const string& filename,
+                             BasicExecutionContext<T>& context,
+                             const RunOptions& options = RunOptions());
+template <typename T>
+void executeCommandsFromStdin(BasicExecutionContext<T>& context,
+                              const RunOptions& options = RunOptions());
+template <typename T>
+bool restoreCheckpoint(BasicExecutionContext<T>& context,
+                       const RunOptions& options, uint64_t& skip);
+template <typename T>
+void finishCheckpoint(const BasicExecutionContext<T>& context,
+                      const RunOptions& options);
+template <typename T>
+void executeCommands(const vector<string>& args, const RunOptions& options);
+int runCommandLine(const vector<string>& args, const RunOptions& options);
+
 int main(int argc, char* argv[]) {
-  if (argc == 2) {
+  vector<string> args(argv + 1, argv + argc);
+
+  // Leading options set the limits and the tracer of every execution context
+  RunOptions options;
+  string tracePath;
+  size_t traceEvery = 1;
+  string snapshotPath;
+  size_t snapshotEvery = 10000;
+  string resultsPath;
+  string resultsIndexPath;
+  size_t first = 0;
+  try {
+    for (; first + 1 < args.size(); first += 2) {
+      if (args[first] == "--trace") {
+        tracePath = args[first + 1];
+      } else if (args[first] == "--trace-every") {
+        traceEvery = stoul(args[first + 1]);
+      } else if (args[first] == "--parallel") {
+        options.threads = stoul(args[first + 1]);
+      } else if (args[first] == "--snapshot") {
+        snapshotPath = args[first + 1];
+      } else if (args[first] == "--snapshot-every") {
+        snapshotEvery = stoul(args[first + 1]);
+      } else if (args[first] == "--results") {
+        resultsPath = args[first + 1];
+      } else if (args[first] == "--results-index") {
+        resultsIndexPath = args[first + 1];
+      } else if (!parseLimitOption(args[first], args[first + 1],
+                                   options.limits)) {
+        break;
+      }
+    }
+  } catch (const exception&) {
+    cerr << "Invalid option value: " << args[first + 1] << endl;
+    return 1;
+  }
+  args.erase(args.begin(), args.begin() + first);
+  unique_ptr<Tracer> tracer;
+  if (!tracePath.empty()) tracer = make_unique<Tracer>(traceEvery);
+  options.tracer = tracer.get();
+  unique_ptr<Checkpointer> checkpointer;
+  if (!snapshotPath.empty()) {
+    checkpointer = make_unique<Checkpointer>(snapshotPath, snapshotEvery);
+  }
+  options.checkpointer = checkpointer.get();
+  ResultWriter results;
+  if (!resultsPath.empty()) {
+    if (!results.open(resultsPath, resultsIndexPath)) {
+      cerr << "Error: Unable to open results " << resultsPath << endl;
+      return 1;
+    }
+    options.results = &results;
+  }
+  executionContext.governor.limits = options.limits;
+  executionContext.tracer = options.tracer;
+  executionContext.results = options.results;
+
+  int status = runCommandLine(args, options);
+  if (!results.close()) {
+    cerr << "Error: Unable to write results " << resultsPath << endl;
+    status = 1;
+  }
+  if (tracer != nullptr && !tracer->writeFile(tracePath)) status = 1;
+  return status;
+}
+
+// Function to run the mode selected by the command line arguments
+int runCommandLine(const vector<string>& args, const RunOptions& options) {
+  if (args.size() >= 2 && args[0] == "--type") {
+    // Run an engine instantiated for the requested numeric type
+    vector<string> rest(args.begin() + 2, args.end());
+    if (args[1] == "float") {
+      executeCommands<float>(rest, options);
+    } else if (args[1] == "double") {
+      executeCommands<double>(rest, options);
+    } else if (args[1] == "long-double") {
+      executeCommands<long double>(rest, options);
+    } else if (args[1] == "fixed") {
+      executeCommands<Fixed64>(rest, options);
+    } else {
+      cerr << "Invalid numeric type.";
+    }
+  } else if (args.size() == 2 && args[0] == "--serve") {
+    return runServer(args[1], options.limits,
+                     options.tracer);  // Serve clients on a Unix domain socket
+  } else if (args.size() == 2 && args[0] == "--client") {
+    return runClient(args[1]);  // Forward stdin to a running server
+  } else if (args.size() == 1) {
     executeCommandsFromFile(
-        argv[1]);  // Execute commands from a file if a filename is provided as
-                   // a command line argument
-  } else if (argc == 1) {
-    executeCommandsFromStdin();  // Execute commands from standard input if no
-                                 // command line argument is provided
+        args[0], executionContext,
+        options);  // Execute commands from a file if a filename is provided
+                   // as a command line argument
+  } else if (args.empty()) {
+    executeCommandsFromStdin(
+        executionContext,
+        options);  // Execute commands from standard input if no command line
+                   // argument is provided
   } else {
     cerr << "Invalid input.";
   }
   return 0;
 }
 
+// Function to execute commands from a file or standard input with a new
+// context of the given numeric type
+template <typename T>
+void executeCommands(const vector<string>& args, const RunOptions& options) {
+  BasicExecutionContext<T> context;
+  context.governor.limits = options.limits;
+  context.tracer = options.tracer;
+  context.results = options.results;
+  if (args.size() == 1) {
+    executeCommandsFromFile(args[0], context, options);
+  } else if (args.empty()) {
+    executeCommandsFromStdin(context, options);
+  } else {
+    cerr << "Invalid input.";
+  }
+}
+
 // Function to execute commands from a file
 void executeCommandsFromFile(const string& filename) {
+  executeCommandsFromFile(filename, executionContext);
+}
+
+// Function to execute commands from standard input
+void executeCommandsFromStdin() { executeCommandsFromStdin(executionContext); }
+
+// Function to process a command string against the global ExecutionContext
+void processCommand(const string& command) {
+  processCommand(command, executionContext);
+}
+
+// Function to execute commands from a file against the given context. With
+// more than one thread the whole file is read first and evaluated as a
+// dataflow graph (see executeScriptParallel)
+template <typename T>
+void executeCommandsFromFile(const string& filename,
+                             BasicExecutionContext<T>& context,
+                             const RunOptions& options) {
   ifstream file(filename);
   if (!file.is_open()) {
     cerr << "Error: Unable to open file " << filename << endl;
     return;
   }
+  uint64_t skip = 0;  // Lines already executed before the last checkpoint
+  if (!restoreCheckpoint(context, options, skip)) return;
+
+  if (options.threads > 1) {
+    vector<string> lines;
+    string line;
+    {
+      if (context.tracer != nullptr) context.tracer->beginLine();
+      TraceSpan readSpan(context.tracer, "read");
+      while (getline(file, line)) lines.push_back(line);
+    }
+    skip = min<uint64_t>(skip, lines.size());
+    lines.erase(lines.begin(), lines.begin() + skip);
+    executeScriptParallel(lines, context, options.threads);
+    if (options.checkpointer != nullptr) {
+      options.checkpointer->linesExecuted(context, lines.size());
+    }
+    finishCheckpoint(context, options);
+    return;
+  }
 
   string line;
-  while (getline(file, line)) {
-    processCommand(line);  // Process each line as a command
+  while (true) {
+    if (context.tracer != nullptr) context.tracer->beginLine();
+    TraceSpan readSpan(context.tracer, "read");
+    if (!getline(file, line)) break;
+    readSpan.end();
+    if (skip > 0) {
+      skip--;
+      continue;
+    }
+    processCommand(line, context);  // Process each line as a command
+    if (options.checkpointer != nullptr) {
+      options.checkpointer->linesExecuted(context);
+    }
   }
 
   file.close();
+  finishCheckpoint(context, options);
 }
 
-// Function to execute commands from standard input
-void executeCommandsFromStdin() {
-  cout << "Enter a commands (or 'exit' to quit):\n";
+// Function to execute commands from standard input against the given context
+template <typename T>
+void executeCommandsFromStdin(BasicExecutionContext<T>& context,
+                              const RunOptions& options) {
+  uint64_t skip = 0;  // Lines already executed before the last checkpoint
+  if (!restoreCheckpoint(context, options, skip)) return;
+  if (context.results == nullptr) {
+    cout << "Enter a commands (or 'exit' to quit):\n";
+  }
   string line;
   while (true) {
-    getline(cin, line);
+    context.governor.pause();  // Waiting for a line is not execution time
+    if (context.tracer != nullptr) context.tracer->beginLine();
+    TraceSpan readSpan(context.tracer, "read");
+    if (!getline(cin, line)) {
+      break;  // End of input
+    }
+    readSpan.end();
     if (line == "exit") {
       break;
     }
+    if (skip > 0) {
+      skip--;
+      continue;
+    }
 
-    processCommand(line);  // Process each line as a command
+    processCommand(line, context);  // Process each line as a command
+    if (options.checkpointer != nullptr) {
+      options.checkpointer->linesExecuted(context);
+    }
   }
+  finishCheckpoint(context, options);
 }
 
-// Function to process a command string
-void processCommand(const string& command) {
-  istringstream iss(command);
-  vector<string> tokens{istream_iterator<string>{iss},
-                        istream_iterator<string>{}};
-
-  if (!tokens.empty()) {
-    try {
-      unique_ptr<Command> cmd = Factory::createCommand(
-          tokens[0], vector<string>(tokens.begin() + 1, tokens.end()));
-      cmd->execute(executionContext);  // Execute the command with the global
-                                       // ExecutionContext
-    } catch (const exception& e) {
-      cerr << "Error: " << e.what()
-           << std::endl;  // Print error message if an exception occurs
-    }
+// Function to restore the context from the last checkpoint, if any. Sets
+// skip to the number of input lines the checkpoint already covers. Returns
+// false if the snapshot cannot be used
+template <typename T>
+bool restoreCheckpoint(BasicExecutionContext<T>& context,
+                       const RunOptions& options, uint64_t& skip) {
+  if (options.checkpointer == nullptr) return true;
+  try {
+    skip = options.checkpointer->restore(context);
+    context.lineNumber = skip;
+  } catch (const exception& e) {
+    cerr << "Error: " << e.what() << endl;
+    return false;
   }
-}
\ No newline at end of file
+  return true;
+}
+
+// Function to write the final checkpoint of the context
+template <typename T>
+void finishCheckpoint(const BasicExecutionContext<T>& context,
+                      const RunOptions& options) {
+  if (options.checkpointer != nullptr &&
+      !options.checkpointer->finish(context)) {
+    cerr << "Error: Unable to write the snapshot." << endl;
+  }
+}
@@ -1,55 +1,325 @@
 #ifndef CALCULATOR_H
 #define CALCULATOR_H
 
+#include <charconv>
 #include <cmath>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <stack>
 #include <stdexcept>
+#include <string_view>
 #include <vector>
 
+#include "arena.h"
+#include "governor.h"
+#include "numeric.h"
+#include "parameters.h"
+#include "reduction.h"
+#include "results.h"
+#include "tracer.h"
+
+// The numeric type of the default engine can be chosen at build time, e.g.
+// -DCALCULATOR_NUMBER=float. Other engines can be instantiated explicitly
+#ifndef CALCULATOR_NUMBER
+#define CALCULATOR_NUMBER double
+#endif
+
 using namespace std;
+using Number = CALCULATOR_NUMBER;  // Numeric type of the default engine
+
 void executeCommandsFromFile(const string& filename);
 void executeCommandsFromStdin();
 void processCommand(const string& command);
 
-// ExecutionContext class holds the state of the calculator
-class ExecutionContext {
+// OperandStack is a stack kept in contiguous storage, so that commands can
+// work on a whole range of operands at once
+template <typename T>
+class OperandStack : public stack<T, vector<T>> {
  public:
-  stack<double> operandStack;             // Stack to hold operands
-  map<string, double> definedParameters;  // Map to store defined parameters
+  // Returns a pointer to the bottom of the stack
+  const T* data() const { return this->c.data(); }
+
+  // Replaces the top count operands with a single value
+  void replaceTop(size_t count, T value) {
+    this->c.resize(this->c.size() - count);
+    this->c.push_back(value);
+  }
+};
+
+// BasicExecutionContext class holds the state of the calculator
+template <typename T>
+class BasicExecutionContext {
+ public:
+  // The parameter maps compare with less<>, so they can be searched by
+  // string_view without building a string
+  OperandStack<T> operandStack;  // Stack to hold operands
+  map<string, T, less<>> definedParameters;  // Map to store defined parameters
+  map<string, DerivedParameter<T>, less<>>
+      derivedParameters;  // Parameters defined by expressions
+  map<string, set<string>, less<>>
+      parameterDependents;  // Derived parameters that read each parameter
+  ostream* output = &cout;    // Stream that PRINT writes to
+  ostream* errors = &cerr;    // Stream for error messages
+  ResourceGovernor governor;  // Limits of untrusted scripts
+  Tracer* tracer = nullptr;   // Records execution phases if set
+  ResultWriter* results = nullptr;  // Binary PRINT output if set
+  uint64_t lineNumber = 0;          // Number of the current input line
+
+  // Function to output a value printed by the given input line
+  void printResult(T value, uint64_t line) {
+    if (results != nullptr) {
+      results->append(NumericTraits<T>::toDouble(value), line);
+    } else {
+      *output << value << endl;
+    }
+  }
+
+  // Function to get the value of a parameter. Derived parameters are
+  // evaluated on first use and memoized
+  T parameterValue(string_view name) {
+    auto derived = derivedParameters.find(name);
+    if (derived == derivedParameters.end()) {
+      auto defined = definedParameters.find(name);
+      return defined == definedParameters.end() ? T(0) : defined->second;
+    }
+    if (!derived->second.valid) evaluateDerived(derived);
+    return derived->second.value;
+  }
+
+  // Function to define a parameter with a value
+  void defineParameter(string_view name, T value) {
+    checkNewParameter(name);
+    removeExpression(name);
+    auto defined = definedParameters.find(name);
+    if (defined == definedParameters.end()) {
+      definedParameters.emplace(name, value);
+    } else {
+      defined->second = value;
+    }
+    invalidateDependents(name);
+  }
+
+  // Function to define a parameter with an expression over other parameters
+  void defineExpression(string_view name,
+                        const ParameterExpression<T>& expression) {
+    checkNewParameter(name);
+    removeExpression(name);
+    auto defined = definedParameters.find(name);
+    if (defined != definedParameters.end()) definedParameters.erase(defined);
+    string key(name);
+    for (const string& input : expression.dependencies()) {
+      parameterDependents[input].insert(key);
+    }
+    derivedParameters[key].expression = expression;
+    invalidateDependents(name);
+  }
+
+ private:
+  // Function to apply the parameter limit to a parameter that is defined
+  void checkNewParameter(string_view name) const {
+    if (definedParameters.count(name) == 0 &&
+        derivedParameters.count(name) == 0) {
+      governor.checkParameterCount(definedParameters.size() +
+                                   derivedParameters.size());
+    }
+  }
+
+  // Function to forget the expression of a derived parameter and the edges
+  // that lead to it
+  void removeExpression(string_view name) {
+    auto derived = derivedParameters.find(name);
+    if (derived == derivedParameters.end()) return;
+    for (const string& input : derived->second.expression.dependencies()) {
+      auto dependents = parameterDependents.find(input);
+      if (dependents == parameterDependents.end()) continue;
+      dependents->second.erase(derived->first);
+      if (dependents->second.empty()) parameterDependents.erase(dependents);
+    }
+    derivedParameters.erase(derived);
+  }
+
+  // Function to evaluate an invalid derived parameter and the invalid
+  // parameters it depends on. They are visited depth first with an explicit
+  // stack, and a parameter is evaluated once its inputs are valid, so a long
+  // chain of definitions does not overflow the call stack. Parameters on the
+  // stack that were visited are marked as evaluating, to find cycles
+  void evaluateDerived(
+      typename map<string, DerivedParameter<T>, less<>>::iterator root) {
+    vector<typename map<string, DerivedParameter<T>, less<>>::iterator>
+        pending{root};
+    try {
+      while (!pending.empty()) {
+        DerivedParameter<T>& parameter = pending.back()->second;
+        if (parameter.valid) {
+          pending.pop_back();
+        } else if (parameter.evaluating) {
+          parameter.value = parameter.expression.evaluate(
+              [this](const string& input) { return parameterValue(input); });
+          parameter.evaluating = false;
+          parameter.valid = true;
+          pending.pop_back();
+        } else {
+          parameter.evaluating = true;
+          for (const string& input : parameter.expression.dependencies()) {
+            auto derived = derivedParameters.find(input);
+            if (derived == derivedParameters.end() || derived->second.valid) {
+              continue;
+            }
+            if (derived->second.evaluating) {
+              throw runtime_error("Cyclic definition of parameter " + input +
+                                  ".");
+            }
+            pending.push_back(derived);
+          }
+        }
+      }
+    } catch (...) {
+      for (auto& visited : pending) visited->second.evaluating = false;
+      throw;
+    }
+  }
+
+  // Function to invalidate the memoized values downstream of a parameter.
+  // A valid value implies valid inputs, so the walk stops at parameters that
+  // are already invalid
+  void invalidateDependents(string_view name) {
+    if (parameterDependents.find(name) == parameterDependents.end()) return;
+    vector<string_view> pending{name};
+    while (!pending.empty()) {
+      auto dependents = parameterDependents.find(pending.back());
+      pending.pop_back();
+      if (dependents == parameterDependents.end()) continue;
+      for (const string& dependent : dependents->second) {
+        DerivedParameter<T>& parameter = derivedParameters[dependent];
+        if (!parameter.valid) continue;
+        parameter.valid = false;
+        pending.push_back(dependent);
+      }
+    }
+  }
 };
 
-ExecutionContext executionContext;  // Global instance of ExecutionContext
+using ExecutionContext = BasicExecutionContext<Number>;
 
-// Command is an abstract class representing a calculator command
-class Command {
+template <typename T>
+class BasicCommand;
+
+// CommandPtr owns a command that lives in a CommandArena
+template <typename T>
+using CommandPtr = unique_ptr<BasicCommand<T>, ArenaDeleter>;
+
+// Global instance of ExecutionContext
+inline ExecutionContext executionContext;
+
+// BasicCommand is an abstract class representing a calculator command
+template <typename T>
+class BasicCommand {
  public:
-  virtual void execute(ExecutionContext& context) const = 0;
-  virtual ~Command() = default;
+  // Returned by operandCount() if the stack holds too few operands
+  static const size_t kInsufficientOperands = SIZE_MAX;
+
+  virtual void execute(BasicExecutionContext<T>& context) const = 0;
+  virtual ~BasicCommand() = default;
+
+  // A pure command replaces the top operandCount() values of the operand
+  // stack with compute() of them and has no other effects, so it can be
+  // evaluated out of order
+  virtual bool isPure() const { return false; }
+
+  // Function to get the number of operands a pure command takes from a stack
+  // of the given size
+  virtual size_t operandCount(size_t stackSize) const {
+    (void)stackSize;  // Suppress unused parameter warning
+    return kInsufficientOperands;
+  }
+
+  // Function to compute the result of a pure command from its operands,
+  // ordered from the bottom of the stack to the top
+  virtual T compute(const T* operands, size_t count) const {
+    (void)operands;  // Suppress unused parameter warning
+    (void)count;
+    throw logic_error("The command is not pure.");
+  }
 };
 
-// PushCommand pushes a value onto the operand stack
-class PushCommand : public Command {
+// BasicUnaryCommand is a pure command that takes the top value of the stack
+template <typename T>
+class BasicUnaryCommand : public BasicCommand<T> {
  public:
-  explicit PushCommand(double val) : value(val) {}
+  bool isPure() const override { return true; }
+  size_t operandCount(size_t stackSize) const override {
+    return stackSize >= 1 ? 1 : BasicCommand<T>::kInsufficientOperands;
+  }
+};
 
-  void execute(ExecutionContext& context) const override {
+// BasicBinaryCommand is a pure command that takes the top two values of the
+// stack
+template <typename T>
+class BasicBinaryCommand : public BasicCommand<T> {
+ public:
+  bool isPure() const override { return true; }
+  size_t operandCount(size_t stackSize) const override {
+    return stackSize >= 2 ? 2 : BasicCommand<T>::kInsufficientOperands;
+  }
+};
+
+// BasicPushCommand pushes a value onto the operand stack
+template <typename T>
+class BasicPushCommand : public BasicCommand<T> {
+ public:
+  explicit BasicPushCommand(T val) : value(val) {}
+
+  void execute(BasicExecutionContext<T>& context) const override {
+    context.governor.checkStackDepth(context.operandStack.size());
     context.operandStack.push(value);  // Push the value onto the stack
   }
 
+  bool isPure() const override { return true; }
+  size_t operandCount(size_t stackSize) const override {
+    (void)stackSize;  // Suppress unused parameter warning
+    return 0;
+  }
+  T compute(const T* operands, size_t count) const override {
+    (void)operands;  // Suppress unused parameter warning
+    (void)count;
+    return value;
+  }
+
  private:
-  double value;  // Value to be pushed onto the stack
+  T value;  // Value to be pushed onto the stack
 };
 
-// PopCommand pops a value from the operand stack
-class PopCommand : public Command {
+// BasicPushParameterCommand pushes the value of a defined parameter. The
+// value is looked up when the command is executed, so the command works
+// against whichever context runs it
+template <typename T>
+class BasicPushParameterCommand : public BasicCommand<T> {
  public:
-  void execute(ExecutionContext& context) const override {
+  explicit BasicPushParameterCommand(
+      string_view name,
+      pmr::memory_resource* memory = pmr::get_default_resource())
+      : paramName(name, memory) {}
+
+  void execute(BasicExecutionContext<T>& context) const override {
+    context.governor.checkStackDepth(context.operandStack.size());
+    context.operandStack.push(context.parameterValue(paramName));
+  }
+
+ private:
+  pmr::string paramName;  // Name of the parameter to be pushed onto the stack
+};
+
+// BasicPopCommand pops a value from the operand stack
+template <typename T>
+class BasicPopCommand : public BasicCommand<T> {
+ public:
+  void execute(BasicExecutionContext<T>& context) const override {
     if (context.operandStack.empty()) {
       throw runtime_error(
           "Pop from an empty stack.");  // Error if stack is empty
@@ -58,292 +328,642 @@ class PopCommand : public Command {
   }
 };
 
-// PrintCommand prints the top value on the operand stack
-class PrintCommand : public Command {
+// BasicPrintCommand prints the top value on the operand stack
+template <typename T>
+class BasicPrintCommand : public BasicCommand<T> {
  public:
-  void execute(ExecutionContext& context) const override {
+  void execute(BasicExecutionContext<T>& context) const override {
     if (context.operandStack.empty()) {
       throw runtime_error(
           "Print from an empty stack.");  // Error if stack is empty
     }
-    cout << context.operandStack.top() << endl;  // Print the top value
+    context.printResult(context.operandStack.top(),
+                        context.lineNumber);  // Print the top value
+  }
+};
+
+// BasicDefineCommand defines a parameter with a specified value
+template <typename T>
+class BasicDefineCommand : public BasicCommand<T> {
+ private:
+  pmr::string paramName;
+  T paramValue;
+
+ public:
+  BasicDefineCommand(
+      string_view name, T value,
+      pmr::memory_resource* memory = pmr::get_default_resource())
+      : paramName(name, memory), paramValue(value) {}
+
+  void execute(BasicExecutionContext<T>& context) const override {
+    context.defineParameter(
+        paramName, paramValue);  // Define the parameter in the ExecutionContext
   }
 };
 
-// DefineCommand defines a parameter with a specified value
-class DefineCommand : public Command {
+// BasicDefineExpressionCommand defines a parameter with an expression over
+// other parameters, which is evaluated lazily when the parameter is used
+template <typename T>
+class BasicDefineExpressionCommand : public BasicCommand<T> {
  private:
-  string paramName;
-  double paramValue;
+  pmr::string paramName;
+  ParameterExpression<T> expression;
 
  public:
-  DefineCommand(const string& name, double value)
-      : paramName(name), paramValue(value) {}
+  BasicDefineExpressionCommand(
+      string_view name, ParameterExpression<T> expr,
+      pmr::memory_resource* memory = pmr::get_default_resource())
+      : paramName(name, memory), expression(move(expr)) {}
 
-  void execute(ExecutionContext& context) const override {
-    context.definedParameters[paramName] =
-        paramValue;  // Define the parameter in the ExecutionContext
+  void execute(BasicExecutionContext<T>& context) const override {
+    context.defineExpression(paramName, expression);
   }
 };
 
-// SqrtCommand calculates the square root of the top value on the operand stack
-class SqrtCommand : public Command {
+// BasicSqrtCommand calculates the square root of the top value on the operand
+// stack
+template <typename T>
+class BasicSqrtCommand : public BasicUnaryCommand<T> {
  public:
-  void execute(ExecutionContext& context) const override {
+  void execute(BasicExecutionContext<T>& context) const override {
     if (context.operandStack.empty()) {
       throw runtime_error(
           "SQRT from an empty stack.");  // Error if stack is empty
     }
-    double operand = context.operandStack.top();
-    if (operand < 0) {
+    T operand = context.operandStack.top();
+    if (operand < T(0)) {
       throw runtime_error(
           "The number under the SQRT must not be negative");  //  SQRT of a
                                                               //  negative
                                                               //  number
     }
     context.operandStack.pop();
-    context.operandStack.push(
-        sqrt(operand));  // Push the square root back onto the stack
+    context.operandStack.push(NumericTraits<T>::squareRoot(
+        operand));  // Push the square root back onto the stack
+  }
+
+  T compute(const T* operands, size_t count) const override {
+    (void)count;  // Suppress unused parameter warning
+    if (operands[0] < T(0)) {
+      throw runtime_error("The number under the SQRT must not be negative");
+    }
+    return NumericTraits<T>::squareRoot(operands[0]);
   }
 };
 
-// AddCommand adds the top two values on the operand stack
-class AddCommand : public Command {
+// BasicAddCommand adds the top two values on the operand stack
+template <typename T>
+class BasicAddCommand : public BasicBinaryCommand<T> {
  public:
-  void execute(ExecutionContext& context) const override {
+  void execute(BasicExecutionContext<T>& context) const override {
     if (context.operandStack.size() < 2) {
       throw runtime_error(
           "Insufficient operands for addition.");  // Error if there are not
                                                    // enough operands
     }
-    double operand2 = context.operandStack.top();
+    T operand2 = context.operandStack.top();
     context.operandStack.pop();
-    double operand1 = context.operandStack.top();
+    T operand1 = context.operandStack.top();
     context.operandStack.pop();
     context.operandStack.push(operand1 +
                               operand2);  // Push the result back onto the stack
   }
+
+  T compute(const T* operands, size_t count) const override {
+    (void)count;  // Suppress unused parameter warning
+    return operands[0] + operands[1];
+  }
 };
 
-// SubCommand substracts the top two values on the operand stack
-class SubCommand : public Command {
+// BasicSubCommand substracts the top two values on the operand stack
+template <typename T>
+class BasicSubCommand : public BasicBinaryCommand<T> {
  public:
-  void execute(ExecutionContext& context) const override {
+  void execute(BasicExecutionContext<T>& context) const override {
     if (context.operandStack.size() < 2) {
       throw runtime_error(
           "Insufficient operands for subtraction.");  // Error if there are not
                                                       // enough operands
     }
-    double operand2 = context.operandStack.top();
+    T operand2 = context.operandStack.top();
     context.operandStack.pop();
-    double operand1 = context.operandStack.top();
+    T operand1 = context.operandStack.top();
     context.operandStack.pop();
     context.operandStack.push(operand1 -
                               operand2);  // Push the result back onto the stack
   }
+
+  T compute(const T* operands, size_t count) const override {
+    (void)count;  // Suppress unused parameter warning
+    return operands[0] - operands[1];
+  }
 };
 
-// MulCommand multiplies the top two values on the operand stack
-class MulCommand : public Command {
+// BasicMulCommand multiplies the top two values on the operand stack
+template <typename T>
+class BasicMulCommand : public BasicBinaryCommand<T> {
  public:
-  void execute(ExecutionContext& context) const override {
+  void execute(BasicExecutionContext<T>& context) const override {
     if (context.operandStack.size() < 2) {
       throw runtime_error(
           "Insufficient operands for multiplication.");  // Error if there are
                                                          // not enough operands
     }
-    double operand2 = context.operandStack.top();
+    T operand2 = context.operandStack.top();
     context.operandStack.pop();
-    double operand1 = context.operandStack.top();
+    T operand1 = context.operandStack.top();
     context.operandStack.pop();
     context.operandStack.push(operand1 *
                               operand2);  // Push the result back onto the stack
   }
+
+  T compute(const T* operands, size_t count) const override {
+    (void)count;  // Suppress unused parameter warning
+    return operands[0] * operands[1];
+  }
 };
 
-// DivCommand divides the top two values on the operand stack
-class DivCommand : public Command {
+// BasicDivCommand divides the top two values on the operand stack
+template <typename T>
+class BasicDivCommand : public BasicBinaryCommand<T> {
  public:
-  void execute(ExecutionContext& context) const override {
+  void execute(BasicExecutionContext<T>& context) const override {
     if (context.operandStack.size() < 2) {
       throw runtime_error(
           "Insufficient operands for division.");  // Error if there are not
                                                    // enough operands
     }
-    double operand2 = context.operandStack.top();
+    T operand2 = context.operandStack.top();
     context.operandStack.pop();
-    double operand1 = context.operandStack.top();
+    T operand1 = context.operandStack.top();
     context.operandStack.pop();
-    if (operand2 == 0) {
+    if (operand2 == T(0)) {
       throw runtime_error(
           "An attempt to divide by 0.");  // Error when dividing by 0
     }
     context.operandStack.push(operand1 /
                               operand2);  // Push the result back onto the stack
   }
+
+  T compute(const T* operands, size_t count) const override {
+    (void)count;  // Suppress unused parameter warning
+    if (operands[1] == T(0)) {
+      throw runtime_error("An attempt to divide by 0.");
+    }
+    return operands[0] / operands[1];
+  }
+};
+
+// BasicReductionCommand folds the top count values on the operand stack (or
+// the whole stack if count is 0) into a single value in one step
+template <typename T>
+class BasicReductionCommand : public BasicCommand<T> {
+ public:
+  explicit BasicReductionCommand(size_t count = 0) : count(count) {}
+
+  void execute(BasicExecutionContext<T>& context) const override {
+    size_t size = context.operandStack.size();
+    size_t n = count == 0 ? size : count;
+    if (n == 0 || n > size) {
+      throw runtime_error("Insufficient operands for " + name() +
+                          ".");  // Error if there are not enough operands
+    }
+    const T* operands = context.operandStack.data() + (size - n);
+    context.operandStack.replaceTop(
+        n, reduce(operands, n));  // Push the result back onto the stack
+  }
+
+  bool isPure() const override { return true; }
+  size_t operandCount(size_t stackSize) const override {
+    size_t n = count == 0 ? stackSize : count;
+    return n == 0 || n > stackSize ? BasicCommand<T>::kInsufficientOperands
+                                   : n;
+  }
+  T compute(const T* operands, size_t n) const override {
+    return reduce(operands, n);
+  }
+
+ protected:
+  virtual string name() const = 0;
+  virtual T reduce(const T* operands, size_t n) const = 0;
+
+ private:
+  size_t count;  // Number of operands to reduce, 0 for the whole stack
+};
+
+// BasicSumCommand adds up the top values on the operand stack
+template <typename T>
+class BasicSumCommand : public BasicReductionCommand<T> {
+ public:
+  using BasicReductionCommand<T>::BasicReductionCommand;
+
+ protected:
+  string name() const override { return "SUM"; }
+  T reduce(const T* operands, size_t n) const override {
+    return reduceSum(operands, n);
+  }
+};
+
+// BasicProdCommand multiplies the top values on the operand stack
+template <typename T>
+class BasicProdCommand : public BasicReductionCommand<T> {
+ public:
+  using BasicReductionCommand<T>::BasicReductionCommand;
+
+ protected:
+  string name() const override { return "PROD"; }
+  T reduce(const T* operands, size_t n) const override {
+    return reduceProduct(operands, n);
+  }
+};
+
+// BasicMinCommand finds the minimum of the top values on the operand stack
+template <typename T>
+class BasicMinCommand : public BasicReductionCommand<T> {
+ public:
+  using BasicReductionCommand<T>::BasicReductionCommand;
+
+ protected:
+  string name() const override { return "MIN"; }
+  T reduce(const T* operands, size_t n) const override {
+    return reduceMin(operands, n);
+  }
+};
+
+// BasicMaxCommand finds the maximum of the top values on the operand stack
+template <typename T>
+class BasicMaxCommand : public BasicReductionCommand<T> {
+ public:
+  using BasicReductionCommand<T>::BasicReductionCommand;
+
+ protected:
+  string name() const override { return "MAX"; }
+  T reduce(const T* operands, size_t n) const override {
+    return reduceMax(operands, n);
+  }
+};
+
+// BasicMeanCommand calculates the mean of the top values on the operand stack
+template <typename T>
+class BasicMeanCommand : public BasicReductionCommand<T> {
+ public:
+  using BasicReductionCommand<T>::BasicReductionCommand;
+
+ protected:
+  string name() const override { return "MEAN"; }
+  T reduce(const T* operands, size_t n) const override {
+    return NumericTraits<T>::divideByCount(reduceSum(operands, n), n);
+  }
+};
+
+// BasicDotCommand calculates the dot product of the top count values on the
+// operand stack and the count values below them. If count is 0, the whole
+// stack is split into two halves
+template <typename T>
+class BasicDotCommand : public BasicCommand<T> {
+ public:
+  explicit BasicDotCommand(size_t count = 0) : count(count) {}
+
+  void execute(BasicExecutionContext<T>& context) const override {
+    size_t size = context.operandStack.size();
+    size_t n = count == 0 ? size / 2 : count;
+    if (n == 0 || (count == 0 && size % 2 != 0) || 2 * n > size) {
+      throw runtime_error(
+          "Insufficient operands for DOT.");  // Error if there are not
+                                              // enough operands
+    }
+    const T* first = context.operandStack.data() + (size - 2 * n);
+    context.operandStack.replaceTop(
+        2 * n, reduceDot(first, first + n,
+                         n));  // Push the result back onto the stack
+  }
+
+  bool isPure() const override { return true; }
+  size_t operandCount(size_t stackSize) const override {
+    size_t n = count == 0 ? stackSize / 2 : count;
+    if (n == 0 || (count == 0 && stackSize % 2 != 0) || 2 * n > stackSize) {
+      return BasicCommand<T>::kInsufficientOperands;
+    }
+    return 2 * n;
+  }
+  T compute(const T* operands, size_t n) const override {
+    return reduceDot(operands, operands + n / 2, n / 2);
+  }
+
+ private:
+  size_t count;  // Length of each segment, 0 for half of the stack
 };
 
 // CommentCommand skips a line starting with '#'
-class NumCommand : public Command {
+template <typename T>
+class BasicNumCommand : public BasicCommand<T> {
  public:
-  void execute(ExecutionContext& context) const override {
+  void execute(BasicExecutionContext<T>& context) const override {
     (void)context;  // Suppress unused parameter warning
     // This command does nothing, as it is just meant to skip comments
   }
 };
 
 // Abstract Factory class
-class CommandFactory {
+template <typename T>
+class BasicCommandFactory {
  public:
-  virtual unique_ptr<Command> createCommand(
-      const vector<string>& args) const = 0;
-  virtual ~CommandFactory() = default;
+  virtual CommandPtr<T> createCommand(CommandArgs args,
+                                      CommandArena& arena) const = 0;
+  virtual ~BasicCommandFactory() = default;
 };
 
 // Concrete factory for PushCommand
-class PushCommandFactory : public CommandFactory {
+template <typename T>
+class BasicPushCommandFactory : public BasicCommandFactory<T> {
  public:
-  unique_ptr<Command> createCommand(const vector<string>& args) const override {
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
     if (args.size() != 1) {
       throw invalid_argument("PUSH command requires one argument.");
     }
     if ((args[0][0] > 64 && args[0][0] < 91) ||
         (args[0][0] > 96 && args[0][0] < 123)) {
-      return make_unique<PushCommand>(
-          executionContext.definedParameters[args[0]]);
+      return arena.make<BasicPushParameterCommand<T>>(args[0],
+                                                       arena.memory());
     }
-    return make_unique<PushCommand>(
-        stod(args[0]));  // Create PushCommand with the specified value
+    return arena.make<BasicPushCommand<T>>(NumericTraits<T>::parse(
+        args[0]));  // Create PushCommand with the specified value
   }
 };
 
 // Concrete factory for PopCommand
-class PopCommandFactory : public CommandFactory {
+template <typename T>
+class BasicPopCommandFactory : public BasicCommandFactory<T> {
  public:
-  unique_ptr<Command> createCommand(const vector<string>& args) const override {
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
     (void)args;  // Suppress unused parameter warning
-    return make_unique<PopCommand>();
+    return arena.make<BasicPopCommand<T>>();
   }
 };
 
 // Concrete factory for PrintCommand
-class PrintCommandFactory : public CommandFactory {
+template <typename T>
+class BasicPrintCommandFactory : public BasicCommandFactory<T> {
  public:
-  unique_ptr<Command> createCommand(const vector<string>& args) const override {
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
     (void)args;  // Suppress unused parameter warning
-    return make_unique<PrintCommand>();
+    return arena.make<BasicPrintCommand<T>>();
   }
 };
 
 // Concrete factory for DefineCommand
-class DefineCommandFactory : public CommandFactory {
+template <typename T>
+class BasicDefineCommandFactory : public BasicCommandFactory<T> {
  public:
-  unique_ptr<Command> createCommand(const vector<string>& args) const override {
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
     if (args.size() == 2) {
-      return make_unique<DefineCommand>(args[0], stod(args[1]));
+      // A number is tried first, so "inf" and "nan" stay literals, while a
+      // token that starts with a letter and is not wholly a number, such as
+      // "x" or "nancy", is a parameter
+      bool letter = isalpha((unsigned char)args[1][0]);
+      try {
+        size_t pos = 0;
+        T value = NumericTraits<T>::parse(args[1], &pos);
+        if (!letter || pos == args[1].size()) {
+          return arena.make<BasicDefineCommand<T>>(args[0], value,
+                                                   arena.memory());
+        }
+      } catch (const logic_error&) {
+        if (!letter) throw;
+      }
+    }
+    if (args.size() >= 2) {
+      return arena.make<BasicDefineExpressionCommand<T>>(
+          args[0], ParameterExpression<T>::parse(args.from(1)),
+          arena.memory());
     } else if (args.size() == 1) {
-      return make_unique<DefineCommand>(args[0], 0.0);
+      return arena.make<BasicDefineCommand<T>>(args[0], T(0),
+                                               arena.memory());
     } else {
-      throw invalid_argument("DEFINE command requires one or two arguments.");
+      throw invalid_argument("DEFINE command requires a name.");
     }
   }
 };
 
 // Concrete factory for SqrtCommand
-class SqrtCommandFactory : public CommandFactory {
+template <typename T>
+class BasicSqrtCommandFactory : public BasicCommandFactory<T> {
  public:
-  unique_ptr<Command> createCommand(const vector<string>& args) const override {
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
     (void)args;  // Suppress unused parameter warning
-    return make_unique<SqrtCommand>();
+    return arena.make<BasicSqrtCommand<T>>();
   }
 };
 
 // Concrete factory for AddCommand
-class AddCommandFactory : public CommandFactory {
+template <typename T>
+class BasicAddCommandFactory : public BasicCommandFactory<T> {
  public:
-  unique_ptr<Command> createCommand(const vector<string>& args) const override {
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
     (void)args;  // Suppress unused parameter warning
-    return make_unique<AddCommand>();
+    return arena.make<BasicAddCommand<T>>();
   }
 };
 
 // Concrete factory for SubCommand
-class SubCommandFactory : public CommandFactory {
+template <typename T>
+class BasicSubCommandFactory : public BasicCommandFactory<T> {
  public:
-  unique_ptr<Command> createCommand(const vector<string>& args) const override {
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
     (void)args;  // Suppress unused parameter warning
-    return make_unique<SubCommand>();
+    return arena.make<BasicSubCommand<T>>();
   }
 };
 
 // Concrete factory for MulCommand
-class MulCommandFactory : public CommandFactory {
+template <typename T>
+class BasicMulCommandFactory : public BasicCommandFactory<T> {
  public:
-  unique_ptr<Command> createCommand(const vector<string>& args) const override {
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
     (void)args;  // Suppress unused parameter warning
-    return make_unique<MulCommand>();
+    return arena.make<BasicMulCommand<T>>();
   }
 };
 
 // Concrete factory for DivCommand
-class DivCommandFactory : public CommandFactory {
+template <typename T>
+class BasicDivCommandFactory : public BasicCommandFactory<T> {
  public:
-  unique_ptr<Command> createCommand(const vector<string>& args) const override {
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
     (void)args;  // Suppress unused parameter warning
-    return make_unique<DivCommand>();
+    return arena.make<BasicDivCommand<T>>();
   }
 };
 
 // Concrete factory for NumCommand
-class NumCommandFactory : public CommandFactory {
+template <typename T>
+class BasicNumCommandFactory : public BasicCommandFactory<T> {
  public:
-  unique_ptr<Command> createCommand(const vector<string>& args) const override {
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
     (void)args;  // Suppress unused parameter warning
-    return make_unique<NumCommand>();
+    return arena.make<BasicNumCommand<T>>();
+  }
+};
+
+// Concrete factory for the reduction commands, which take an optional count
+template <typename T, typename ReductionCommand>
+class BasicReductionCommandFactory : public BasicCommandFactory<T> {
+ public:
+  CommandPtr<T> createCommand(CommandArgs args,
+                              CommandArena& arena) const override {
+    if (args.empty()) {
+      return arena.make<ReductionCommand>();  // Reduce the whole stack
+    }
+    size_t count = 0;
+    if (args.size() != 1 ||
+        args[0].find_first_not_of("0123456789") != string_view::npos ||
+        from_chars(args[0].data(), args[0].data() + args[0].size(), count)
+                .ec != errc() ||
+        count == 0) {
+      throw invalid_argument(
+          "Reduction commands require an optional positive count.");
+    }
+    return arena.make<ReductionCommand>(count);
   }
 };
 
-// Factory creates instances of specific commands based on the command name
-class Factory {
+// BasicFactory creates instances of specific commands based on the command
+// name
+template <typename T>
+class BasicFactory {
  public:
-  static unique_ptr<Command> createCommand(const string& commandName,
-                                           const vector<string>& args) {
+  static CommandPtr<T> createCommand(string_view commandName,
+                                     CommandArgs args, CommandArena& arena) {
     // Use the appropriate factory based on commandName
     if (commandName == "PUSH") {
-      PushCommandFactory factory;
+      BasicPushCommandFactory<T> factory;
       return factory.createCommand(
-          args);  // Create PushCommand with the specified value
+          args, arena);  // Create PushCommand with the specified value
     } else if (commandName == "POP") {
-      PopCommandFactory factory;
-      return factory.createCommand(args);  // Create PopCommand
+      BasicPopCommandFactory<T> factory;
+      return factory.createCommand(args, arena);  // Create PopCommand
     } else if (commandName == "PRINT") {
-      PrintCommandFactory factory;
-      return factory.createCommand(args);  // Create PrintCommand
+      BasicPrintCommandFactory<T> factory;
+      return factory.createCommand(args, arena);  // Create PrintCommand
     } else if (commandName == "DEFINE") {
-      DefineCommandFactory factory;
-      return factory.createCommand(args);
+      BasicDefineCommandFactory<T> factory;
+      return factory.createCommand(args, arena);
     } else if (commandName == "SQRT") {
-      SqrtCommandFactory factory;
-      return factory.createCommand(args);  // Create SqrtCommand
+      BasicSqrtCommandFactory<T> factory;
+      return factory.createCommand(args, arena);  // Create SqrtCommand
     } else if (commandName == "+") {
-      AddCommandFactory factory;
-      return factory.createCommand(args);  // Create AddCommand
+      BasicAddCommandFactory<T> factory;
+      return factory.createCommand(args, arena);  // Create AddCommand
     } else if (commandName == "-") {
-      SubCommandFactory factory;
-      return factory.createCommand(args);  // Create SubCommand
+      BasicSubCommandFactory<T> factory;
+      return factory.createCommand(args, arena);  // Create SubCommand
     } else if (commandName == "*") {
-      MulCommandFactory factory;
-      return factory.createCommand(args);  // Create MulCommand
+      BasicMulCommandFactory<T> factory;
+      return factory.createCommand(args, arena);  // Create MulCommand
     } else if (commandName == "/") {
-      DivCommandFactory factory;
-      return factory.createCommand(args);  // Create DivCommand
+      BasicDivCommandFactory<T> factory;
+      return factory.createCommand(args, arena);  // Create DivCommand
+    } else if (commandName == "SUM") {
+      BasicReductionCommandFactory<T, BasicSumCommand<T>> factory;
+      return factory.createCommand(args, arena);  // Create SumCommand
+    } else if (commandName == "PROD") {
+      BasicReductionCommandFactory<T, BasicProdCommand<T>> factory;
+      return factory.createCommand(args, arena);  // Create ProdCommand
+    } else if (commandName == "MIN") {
+      BasicReductionCommandFactory<T, BasicMinCommand<T>> factory;
+      return factory.createCommand(args, arena);  // Create MinCommand
+    } else if (commandName == "MAX") {
+      BasicReductionCommandFactory<T, BasicMaxCommand<T>> factory;
+      return factory.createCommand(args, arena);  // Create MaxCommand
+    } else if (commandName == "MEAN") {
+      BasicReductionCommandFactory<T, BasicMeanCommand<T>> factory;
+      return factory.createCommand(args, arena);  // Create MeanCommand
+    } else if (commandName == "DOT") {
+      BasicReductionCommandFactory<T, BasicDotCommand<T>> factory;
+      return factory.createCommand(args, arena);  // Create DotCommand
     } else if (commandName == "#") {
-      NumCommandFactory factory;
-      return factory.createCommand(args);  // Create NumCommand
+      BasicNumCommandFactory<T> factory;
+      return factory.createCommand(args, arena);  // Create NumCommand
     } else {
       throw invalid_argument("Unknown command.");  // Error for unknown command
     }
   }
 };
 
-#endif
\ No newline at end of file
+// Names of the default engine, which works with the Number type
+using Command = BasicCommand<Number>;
+using PushCommand = BasicPushCommand<Number>;
+using PushParameterCommand = BasicPushParameterCommand<Number>;
+using PopCommand = BasicPopCommand<Number>;
+using PrintCommand = BasicPrintCommand<Number>;
+using DefineCommand = BasicDefineCommand<Number>;
+using DefineExpressionCommand = BasicDefineExpressionCommand<Number>;
+using SqrtCommand = BasicSqrtCommand<Number>;
+using AddCommand = BasicAddCommand<Number>;
+using SubCommand = BasicSubCommand<Number>;
+using MulCommand = BasicMulCommand<Number>;
+using DivCommand = BasicDivCommand<Number>;
+using SumCommand = BasicSumCommand<Number>;
+using ProdCommand = BasicProdCommand<Number>;
+using MinCommand = BasicMinCommand<Number>;
+using MaxCommand = BasicMaxCommand<Number>;
+using MeanCommand = BasicMeanCommand<Number>;
+using DotCommand = BasicDotCommand<Number>;
+using NumCommand = BasicNumCommand<Number>;
+using CommandFactory = BasicCommandFactory<Number>;
+using PushCommandFactory = BasicPushCommandFactory<Number>;
+using PopCommandFactory = BasicPopCommandFactory<Number>;
+using PrintCommandFactory = BasicPrintCommandFactory<Number>;
+using DefineCommandFactory = BasicDefineCommandFactory<Number>;
+using SqrtCommandFactory = BasicSqrtCommandFactory<Number>;
+using AddCommandFactory = BasicAddCommandFactory<Number>;
+using SubCommandFactory = BasicSubCommandFactory<Number>;
+using MulCommandFactory = BasicMulCommandFactory<Number>;
+using DivCommandFactory = BasicDivCommandFactory<Number>;
+using NumCommandFactory = BasicNumCommandFactory<Number>;
+using Factory = BasicFactory<Number>;
+
+// Function to process a command string against the given context. The
+// tokens and the command are built in an arena of the calling thread that is
+// released after every line, so a typical line does not allocate
+template <typename T>
+void processCommand(string_view command, BasicExecutionContext<T>& context) {
+  static thread_local CommandArena arena;
+  context.lineNumber++;
+  {
+    TraceSpan tokenizeSpan(context.tracer, "tokenize");
+    pmr::vector<string_view> tokens(arena.memory());
+    tokenizeCommand(command, tokens);
+    tokenizeSpan.end();
+
+    if (!tokens.empty()) {
+      try {
+        TraceSpan createSpan(context.tracer, "create");
+        CommandPtr<T> cmd = BasicFactory<T>::createCommand(
+            tokens[0], CommandArgs(tokens.data() + 1, tokens.size() - 1),
+            arena);
+        createSpan.end();
+        context.governor.chargeCommand();
+        TraceSpan executeSpan(context.tracer, "execute");
+        cmd->execute(context);  // Execute the command with the context
+      } catch (const exception& e) {
+        *context.errors << "Error: " << e.what()
+                        << std::endl;  // Print error message if an exception
+                                       // occurs
+      }
+    }
+  }
+  arena.release();
+}
+
+#endif
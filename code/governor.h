@@ -0,0 +1,115 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// ResourceLimitError is thrown when a script exceeds one of the limits of its
+// execution context
+class ResourceLimitError : public runtime_error {
+ public:
+  explicit ResourceLimitError(const string& message)
+      : runtime_error(message) {}
+};
+
+// ExecutionLimits holds the limits of an execution context. 0 means that the
+// resource is not limited
+struct ExecutionLimits {
+  size_t maxStackDepth = 0;             // Values on the operand stack
+  size_t maxParameters = 0;             // Defined parameters
+  size_t maxCommands = 0;               // Executed commands
+  chrono::milliseconds maxWallTime{0};  // Time spent executing commands
+};
+
+// ResourceGovernor enforces the limits of an execution context. Commands are
+// counted on every call, while the clock is read only once per
+// kClockCheckInterval commands to keep the check cheap. The clock runs from
+// the first command after a pause() to the next pause(), so a session that
+// waits for input between lines is not charged for the wait
+class ResourceGovernor {
+ public:
+  static const size_t kClockCheckInterval = 1024;
+
+  ExecutionLimits limits;
+
+  // Function to account for a command that is about to be executed
+  void chargeCommand() {
+    if (exceeded != nullptr) throw ResourceLimitError(exceeded);
+    commandsExecuted++;
+    if (limits.maxCommands != 0 && commandsExecuted > limits.maxCommands) {
+      fail("Command limit exceeded.");
+    }
+    if (limits.maxWallTime.count() != 0) {
+      if (!running) {
+        if (elapsed > limits.maxWallTime) fail("Time limit exceeded.");
+        started = chrono::steady_clock::now();
+        running = true;
+      } else if (commandsExecuted % kClockCheckInterval == 0 &&
+                 elapsed + (chrono::steady_clock::now() - started) >
+                     limits.maxWallTime) {
+        fail("Time limit exceeded.");
+      }
+    }
+  }
+
+  // Function to stop the clock while the script waits for input. It starts
+  // again with the next command
+  void pause() {
+    if (!running) return;
+    elapsed += chrono::steady_clock::now() - started;
+    running = false;
+  }
+
+  // Function to check that one more value fits on a stack of the given size
+  void checkStackDepth(size_t size) const {
+    if (limits.maxStackDepth != 0 && size >= limits.maxStackDepth) {
+      throw ResourceLimitError("Stack depth limit exceeded.");
+    }
+  }
+
+  // Function to check that one more parameter can be defined
+  void checkParameterCount(size_t count) const {
+    if (limits.maxParameters != 0 && count >= limits.maxParameters) {
+      throw ResourceLimitError("Parameter limit exceeded.");
+    }
+  }
+
+  size_t getCommandsExecuted() const { return commandsExecuted; }
+
+ private:
+  size_t commandsExecuted = 0;
+  chrono::steady_clock::duration elapsed{0};  // Time of the finished runs
+  chrono::steady_clock::time_point started;  // Start of the current run
+  bool running = false;
+  const char* exceeded = nullptr;  // Limit that stopped the script, if any
+
+  // Once the command or time limit is exceeded, every later command fails
+  [[noreturn]] void fail(const char* message) {
+    exceeded = message;
+    throw ResourceLimitError(message);
+  }
+};
+
+// Function to parse a command line option that sets a limit. Returns false
+// if the option is not a limit option
+inline bool parseLimitOption(const string& option, const string& value,
+                             ExecutionLimits& limits) {
+  if (option == "--max-stack") {
+    limits.maxStackDepth = stoul(value);
+  } else if (option == "--max-params") {
+    limits.maxParameters = stoul(value);
+  } else if (option == "--max-commands") {
+    limits.maxCommands = stoul(value);
+  } else if (option == "--max-time-ms") {
+    limits.maxWallTime = chrono::milliseconds(stoul(value));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef NUMERIC_H
+#define NUMERIC_H
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Fixed64 is a signed fixed-point number with 32 integer and 32 fractional
+// bits stored in an int64_t. Arithmetic never touches the FPU: products and
+// quotients are computed with 128-bit intermediates and truncated
+class Fixed64 {
+ public:
+  static const int kFractionBits = 32;
+  static const int64_t kOne = int64_t(1) << kFractionBits;
+
+  int64_t raw;  // Value multiplied by 2^32
+
+  constexpr Fixed64() : raw(0) {}
+  constexpr Fixed64(int value) : raw(int64_t(value) * kOne) {}
+
+  static constexpr Fixed64 fromRaw(int64_t value) {
+    Fixed64 result;
+    result.raw = value;
+    return result;
+  }
+
+  friend Fixed64 operator+(Fixed64 a, Fixed64 b) {
+    return fromRaw(a.raw + b.raw);
+  }
+  friend Fixed64 operator-(Fixed64 a, Fixed64 b) {
+    return fromRaw(a.raw - b.raw);
+  }
+  friend Fixed64 operator*(Fixed64 a, Fixed64 b) {
+    return fromRaw(int64_t((__int128(a.raw) * b.raw) >> kFractionBits));
+  }
+  friend Fixed64 operator/(Fixed64 a, Fixed64 b) {
+    return fromRaw(int64_t((__int128(a.raw) << kFractionBits) / b.raw));
+  }
+  friend bool operator==(Fixed64 a, Fixed64 b) { return a.raw == b.raw; }
+  friend bool operator!=(Fixed64 a, Fixed64 b) { return a.raw != b.raw; }
+  friend bool operator<(Fixed64 a, Fixed64 b) { return a.raw < b.raw; }
+  friend bool operator>(Fixed64 a, Fixed64 b) { return a.raw > b.raw; }
+  friend bool operator<=(Fixed64 a, Fixed64 b) { return a.raw <= b.raw; }
+  friend bool operator>=(Fixed64 a, Fixed64 b) { return a.raw >= b.raw; }
+};
+
+// Function to calculate the square root of a non-negative Fixed64 with
+// the bit-by-bit integer method
+inline Fixed64 sqrt(Fixed64 value) {
+  unsigned __int128 remainder = (unsigned __int128)value.raw
+                                << Fixed64::kFractionBits;
+  unsigned __int128 result = 0;
+  unsigned __int128 bit = (unsigned __int128)1 << 126;
+  while (bit > remainder) bit >>= 2;
+  while (bit != 0) {
+    if (remainder >= result + bit) {
+      remainder -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return Fixed64::fromRaw(int64_t(result));
+}
+
+// Function to print a Fixed64 with up to six fractional digits
+inline ostream& operator<<(ostream& out, Fixed64 value) {
+  uint64_t magnitude =
+      value.raw < 0 ? uint64_t(0) - uint64_t(value.raw) : uint64_t(value.raw);
+  uint64_t integerPart = magnitude >> Fixed64::kFractionBits;
+  uint64_t fraction = magnitude & (uint64_t(Fixed64::kOne) - 1);
+  const uint64_t scale = 1000000;
+  uint64_t digits =
+      ((unsigned __int128)fraction * scale + (uint64_t(Fixed64::kOne) >> 1)) >>
+      Fixed64::kFractionBits;
+  if (digits == scale) {  // Rounding carried into the integer part
+    integerPart++;
+    digits = 0;
+  }
+  if (value.raw < 0 && (integerPart != 0 || digits != 0)) out << '-';
+  out << integerPart;
+  if (digits != 0) {
+    int width = 6;
+    while (digits % 10 == 0) {
+      digits /= 10;
+      width--;
+    }
+    out << '.' << setw(width) << setfill('0') << digits << setfill(' ');
+  }
+  return out;
+}
+
+// Function to parse a floating-point number with a strtod-like function. It
+// behaves like stod, but copies short tokens to the stack instead of into a
+// string. The number of characters parsed is stored in pos if it is given
+template <typename T>
+T parseFloating(string_view text, T (*convert)(const char*, char**),
+                const char* name, size_t* pos = nullptr) {
+  char local[64];
+  string copy;
+  const char* begin = local;
+  if (text.size() < sizeof(local)) {
+    memcpy(local, text.data(), text.size());
+    local[text.size()] = '\0';
+  } else {
+    copy.assign(text);
+    begin = copy.c_str();
+  }
+  char* end;
+  int savedErrno = errno;
+  errno = 0;
+  T value = convert(begin, &end);
+  bool outOfRange = errno == ERANGE;
+  errno = savedErrno;
+  if (end == begin) throw invalid_argument(name);
+  if (outOfRange) throw out_of_range(name);
+  if (pos != nullptr) *pos = size_t(end - begin);
+  return value;
+}
+
+// NumericTraits describes how the calculator parses and computes with a
+// numeric type
+template <typename T>
+struct NumericTraits;
+
+template <>
+struct NumericTraits<float> {
+  static float parse(string_view text, size_t* pos = nullptr) {
+    return parseFloating<float>(text, strtof, "stof", pos);
+  }
+  static float squareRoot(float value) { return std::sqrt(value); }
+  static double toDouble(float value) { return value; }
+  static float divideByCount(float value, size_t count) {
+    return value / static_cast<float>(count);
+  }
+};
+
+template <>
+struct NumericTraits<double> {
+  static double parse(string_view text, size_t* pos = nullptr) {
+    return parseFloating<double>(text, strtod, "stod", pos);
+  }
+  static double squareRoot(double value) { return std::sqrt(value); }
+  static double toDouble(double value) { return value; }
+  static double divideByCount(double value, size_t count) {
+    return value / static_cast<double>(count);
+  }
+};
+
+template <>
+struct NumericTraits<long double> {
+  static long double parse(string_view text, size_t* pos = nullptr) {
+    return parseFloating<long double>(text, strtold, "stold", pos);
+  }
+  static long double squareRoot(long double value) { return std::sqrt(value); }
+  static double toDouble(long double value) { return double(value); }
+  static long double divideByCount(long double value, size_t count) {
+    return value / static_cast<long double>(count);
+  }
+};
+
+template <>
+struct NumericTraits<Fixed64> {
+  // Parses an optionally signed decimal number such as "-10.25". The whole
+  // text must be the number, so the length is stored in parsed if it is given
+  static Fixed64 parse(string_view text, size_t* parsed = nullptr) {
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) {
+      negative = text[pos++] == '-';
+    }
+    unsigned __int128 integerPart = 0;
+    size_t digits = 0;
+    while (pos < text.size() && isdigit((unsigned char)text[pos])) {
+      integerPart = integerPart * 10 + (text[pos++] - '0');
+      digits++;
+    }
+    unsigned __int128 fraction = 0;
+    unsigned __int128 scale = 1;
+    if (pos < text.size() && text[pos] == '.') {
+      pos++;
+      while (pos < text.size() && isdigit((unsigned char)text[pos])) {
+        if (scale < 1000000000000000000ULL) {  // Extra digits are ignored
+          fraction = fraction * 10 + (text[pos] - '0');
+          scale *= 10;
+        }
+        pos++;
+        digits++;
+      }
+    }
+    if (digits == 0 || pos != text.size() ||
+        integerPart >= (unsigned __int128)1 << 31) {
+      throw invalid_argument("Invalid fixed-point number.");
+    }
+    int64_t raw = int64_t((integerPart << Fixed64::kFractionBits) +
+                          ((fraction << Fixed64::kFractionBits) / scale));
+    if (parsed != nullptr) *parsed = pos;
+    return Fixed64::fromRaw(negative ? -raw : raw);
+  }
+
+  static Fixed64 squareRoot(Fixed64 value) { return sqrt(value); }
+  static double toDouble(Fixed64 value) {
+    return double(value.raw) / double(Fixed64::kOne);
+  }
+  // Counts of 2^31 and more are out of the range of Fixed64, so the raw
+  // value is divided directly
+  static Fixed64 divideByCount(Fixed64 value, size_t count) {
+    return Fixed64::fromRaw(value.raw / int64_t(count));
+  }
+};
+
+#endif
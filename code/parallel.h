@@ -0,0 +1,359 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "calculator.h"
+
+using namespace std;
+
+// DataflowNode is a value of a script: either known during the analysis (a
+// pushed number, a parameter or an operand that was on the stack before the
+// script) or the result of a pure command over other nodes
+template <typename T>
+struct DataflowNode {
+  const BasicCommand<T>* command = nullptr;  // nullptr for known values
+  vector<size_t> inputs;                      // Operands, bottom to top
+  vector<size_t> consumers;                   // Nodes that read this value
+  T value = T(0);
+};
+
+// ScriptEvent is an observable effect of a script line: a printed value or
+// an error message, replayed in the order of the lines
+struct ScriptEvent {
+  bool isError;
+  size_t node;     // Printed node
+  uint64_t line;   // Input line that printed the node
+  string message;  // Error message
+};
+
+// DataflowScript turns a straight-line script into a dataflow graph by
+// following the stack effects of its commands, and evaluates independent
+// parts of the graph on several threads. A graph that reads fewer than
+// kMinParallelWork operands in total is evaluated on the calling thread,
+// since starting the workers would cost more than the whole script
+template <typename T>
+class DataflowScript {
+ public:
+  static const size_t kMinParallelWork = 4096;
+  // Operands a node reads before it is worth handing to another worker
+  static const size_t kParallelCost = 64;
+
+  DataflowScript(BasicExecutionContext<T>& context, size_t threads)
+      : context(context), threads(threads == 0 ? 1 : threads) {}
+
+  // Function to build the graph. Commands that do not touch the operand
+  // stack (DEFINE, PUSH of a parameter) are executed right away. Returns
+  // false if the script contains a command the analysis does not support
+  bool analyze(const vector<string>& lines) {
+    for (size_t i = 0; i < context.operandStack.size(); i++) {
+      shape.push_back(addKnown(context.operandStack.data()[i]));
+    }
+    for (const string& line : lines) {
+      if (context.tracer != nullptr) context.tracer->beginLine();
+      if (!analyzeLine(line)) return false;
+    }
+    return true;
+  }
+
+  // Function to evaluate the graph. Returns false if a command failed, in
+  // which case nothing has been printed and the results are incomplete
+  bool evaluate() {
+    size_t operandsRead = 0;
+    for (const DataflowNode<T>& node : nodes) {
+      operandsRead += node.inputs.size();
+    }
+    if (threads == 1 || operandsRead < kMinParallelWork) {
+      return evaluateInOrder();
+    }
+
+    pending = vector<atomic<size_t>>(nodes.size());
+    for (size_t id = 0; id < nodes.size(); id++) {
+      if (nodes[id].command == nullptr) continue;
+      remaining++;
+      for (size_t input : nodes[id].inputs) {
+        if (nodes[input].command == nullptr) continue;
+        nodes[input].consumers.push_back(id);
+        pending[id]++;
+      }
+    }
+    for (size_t id = 0; id < nodes.size(); id++) {
+      if (nodes[id].command != nullptr && pending[id] == 0) {
+        ready.push_back(id);
+      }
+    }
+    if (remaining == 0) return true;
+
+    vector<thread> workers;
+    size_t count = min(threads, remaining.load());
+    for (size_t i = 1; i < count; i++) {
+      workers.emplace_back([this] { work(); });
+    }
+    work();
+    for (thread& worker : workers) worker.join();
+    return !failed;
+  }
+
+  // Function to undo the changes the analysis made to the parameters of the
+  // context, before the script is executed sequentially
+  void restoreParameters() {
+    if (!parametersSaved) return;
+    context.definedParameters = move(savedDefined);
+    context.derivedParameters = move(savedDerived);
+    context.parameterDependents = move(savedDependents);
+    parametersSaved = false;
+  }
+
+  // Function to print the results and errors in the order of the lines and
+  // to replace the operand stack with the final values
+  void commit() {
+    for (const ScriptEvent& event : events) {
+      if (event.isError) {
+        *context.errors << "Error: " << event.message << std::endl;
+      } else {
+        context.printResult(nodes[event.node].value, event.line);
+      }
+    }
+    context.operandStack = OperandStack<T>();
+    for (size_t id : shape) context.operandStack.push(nodes[id].value);
+  }
+
+ private:
+  BasicExecutionContext<T>& context;
+  size_t threads;
+  CommandArena arena;  // Holds the commands of the whole script
+  vector<CommandPtr<T>> commands;
+  vector<string_view> tokens;  // Tokens of the current line
+  vector<DataflowNode<T>> nodes;
+  vector<size_t> shape;  // Nodes on the operand stack, bottom to top
+  vector<ScriptEvent> events;
+
+  vector<atomic<size_t>> pending;  // Inputs each node still waits for
+  atomic<size_t> remaining{0};     // Nodes that are not evaluated yet
+  atomic<bool> failed{false};
+  vector<size_t> ready;  // Nodes whose inputs are all evaluated
+  mutex readyMutex;
+  condition_variable readyChanged;
+
+  // Parameters of the context before the first DEFINE of the script. Other
+  // commands do not change them, so most scripts need no copy
+  bool parametersSaved = false;
+  decltype(BasicExecutionContext<T>::definedParameters) savedDefined;
+  decltype(BasicExecutionContext<T>::derivedParameters) savedDerived;
+  decltype(BasicExecutionContext<T>::parameterDependents) savedDependents;
+
+  size_t addKnown(T value) {
+    nodes.emplace_back();
+    nodes.back().value = value;
+    return nodes.size() - 1;
+  }
+
+  void addError(const string& message) {
+    events.push_back({true, 0, 0, message});
+  }
+
+  // Function to find the error a command reports for a stack of the given
+  // size, by executing it on a scratch context of that size
+  bool shapeError(const BasicCommand<T>& command, size_t stackSize) {
+    BasicExecutionContext<T> scratch;
+    for (size_t i = 0; i < stackSize; i++) scratch.operandStack.push(T(1));
+    try {
+      command.execute(scratch);
+    } catch (const exception& e) {
+      addError(e.what());
+      return true;
+    }
+    return false;  // The command does not fail for shape reasons
+  }
+
+  bool analyzeLine(const string& line) {
+    context.lineNumber++;
+    tokens.clear();
+    tokenizeCommand(line, tokens);
+    if (tokens.empty()) return true;
+
+    CommandPtr<T> created;
+    try {
+      TraceSpan createSpan(context.tracer, "create");
+      created = BasicFactory<T>::createCommand(
+          tokens[0], CommandArgs(tokens.data() + 1, tokens.size() - 1), arena);
+      context.governor.chargeCommand();
+    } catch (const exception& e) {
+      addError(e.what());
+      return true;
+    }
+    const BasicCommand<T>* command = created.get();
+    commands.push_back(move(created));
+
+    if (command->isPure()) {
+      size_t count = command->operandCount(shape.size());
+      if (count == BasicCommand<T>::kInsufficientOperands) {
+        return shapeError(*command, shape.size());
+      }
+      if (count == 0) {  // A pushed number is known right away
+        shape.push_back(addKnown(command->compute(nullptr, 0)));
+        return true;
+      }
+      nodes.emplace_back();
+      nodes.back().command = command;
+      nodes.back().inputs.assign(shape.end() - count, shape.end());
+      shape.resize(shape.size() - count);
+      shape.push_back(nodes.size() - 1);
+    } else if (dynamic_cast<const BasicPushParameterCommand<T>*>(command) !=
+               nullptr) {
+      try {
+        command->execute(context);
+      } catch (const exception& e) {
+        addError(e.what());
+        return true;
+      }
+      shape.push_back(addKnown(context.operandStack.top()));
+      context.operandStack.pop();
+    } else if (dynamic_cast<const BasicDefineCommand<T>*>(command) !=
+                   nullptr ||
+               dynamic_cast<const BasicDefineExpressionCommand<T>*>(
+                   command) != nullptr) {
+      if (!parametersSaved) {
+        savedDefined = context.definedParameters;
+        savedDerived = context.derivedParameters;
+        savedDependents = context.parameterDependents;
+        parametersSaved = true;
+      }
+      try {
+        command->execute(context);
+      } catch (const exception& e) {
+        addError(e.what());
+      }
+    } else if (dynamic_cast<const BasicPopCommand<T>*>(command) != nullptr) {
+      if (shape.empty()) return shapeError(*command, 0);
+      shape.pop_back();
+    } else if (dynamic_cast<const BasicPrintCommand<T>*>(command) !=
+               nullptr) {
+      if (shape.empty()) return shapeError(*command, 0);
+      events.push_back({false, shape.back(), context.lineNumber, ""});
+    } else if (dynamic_cast<const BasicNumCommand<T>*>(command) == nullptr) {
+      return false;
+    }
+    return true;
+  }
+
+  // Function to evaluate the nodes one after another on the calling thread.
+  // Every node is created after its inputs, so this is a dependency order
+  bool evaluateInOrder() {
+    if (context.tracer != nullptr) context.tracer->beginLine();
+    TraceSpan executeSpan(context.tracer, "execute");
+    vector<T> operands;
+    for (size_t id = 0; id < nodes.size(); id++) {
+      if (nodes[id].command != nullptr && !evaluateNode(id, operands)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Worker loop: takes a batch of ready nodes, evaluates them and releases
+  // their consumers. A batch is a share of the ready list, so workers lock it
+  // less often while it is long and still balance the load once it is short.
+  // A worker evaluates the released consumers itself, except that a second
+  // one reading at least kParallelCost operands goes to the shared list
+  void work() {
+    vector<size_t> local;  // Nodes this worker evaluates itself
+    vector<T> operands;    // Operands of the current node
+    while (true) {
+      {
+        unique_lock<mutex> lock(readyMutex);
+        readyChanged.wait(lock, [this] {
+          return !ready.empty() || remaining == 0 || failed;
+        });
+        if (remaining == 0 || failed) return;
+        size_t batch = max<size_t>(1, ready.size() / (2 * threads));
+        local.assign(ready.end() - batch, ready.end());
+        ready.resize(ready.size() - batch);
+      }
+      if (context.tracer != nullptr) context.tracer->beginLine();
+      TraceSpan executeSpan(context.tracer, "execute");
+      while (!local.empty()) {
+        size_t id = local.back();
+        local.pop_back();
+        if (!evaluateNode(id, operands)) {
+          lock_guard<mutex> lock(readyMutex);
+          failed = true;
+          readyChanged.notify_all();
+          return;
+        }
+        bool kept = false;
+        for (size_t consumer : nodes[id].consumers) {
+          if (pending[consumer].fetch_sub(1, memory_order_acq_rel) != 1) {
+            continue;
+          }
+          if (!kept || nodes[consumer].inputs.size() < kParallelCost) {
+            local.push_back(consumer);
+            kept = true;
+          } else {
+            lock_guard<mutex> lock(readyMutex);
+            ready.push_back(consumer);
+            readyChanged.notify_one();
+          }
+        }
+        if (remaining.fetch_sub(1, memory_order_acq_rel) == 1) {
+          lock_guard<mutex> lock(readyMutex);
+          readyChanged.notify_all();
+          return;
+        }
+      }
+    }
+  }
+
+  // Function to compute a node. The operands are gathered into a buffer that
+  // the caller reuses, so no allocation is made per node
+  bool evaluateNode(size_t id, vector<T>& operands) {
+    DataflowNode<T>& node = nodes[id];
+    operands.clear();
+    for (size_t input : node.inputs) operands.push_back(nodes[input].value);
+    try {
+      node.value = node.command->compute(operands.data(), operands.size());
+    } catch (const exception&) {
+      return false;
+    }
+    return true;
+  }
+};
+
+// Function to execute a straight-line script with independent parts of it
+// evaluated on several threads. Printed values, error messages and the final
+// state are the same as with sequential execution: the script falls back to
+// sequential execution if it uses an unsupported command, if the context has
+// resource limits or if a command fails with a value-dependent error
+template <typename T>
+void executeScriptParallel(const vector<string>& lines,
+                           BasicExecutionContext<T>& context, size_t threads) {
+  const ExecutionLimits& limits = context.governor.limits;
+  bool limited = limits.maxStackDepth != 0 || limits.maxParameters != 0 ||
+                 limits.maxCommands != 0 || limits.maxWallTime.count() != 0;
+  if (!limited) {
+    // The analysis changes the parameters, the line number and the command
+    // count, and leaves the operand stack as it was; the script saves the
+    // parameters itself, only if it defines one
+    ResourceGovernor governor = context.governor;
+    uint64_t lineNumber = context.lineNumber;
+    {
+      DataflowScript<T> script(context, threads);
+      if (script.analyze(lines) && script.evaluate()) {
+        script.commit();
+        return;
+      }
+      script.restoreParameters();
+    }
+    context.governor = governor;
+    context.lineNumber = lineNumber;
+  }
+  for (const string& line : lines) {
+    if (context.tracer != nullptr) context.tracer->beginLine();
+    processCommand(line, context);
+  }
+}
+
+#endif
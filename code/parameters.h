@@ -0,0 +1,142 @@
+#ifndef PARAMETERS_H
+#define PARAMETERS_H
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "numeric.h"
+
+using namespace std;
+
+// ExpressionToken is a single step of a parameter expression
+template <typename T>
+struct ExpressionToken {
+  enum Kind { Literal, Parameter, Add, Sub, Mul, Div, Sqrt };
+
+  Kind kind;
+  T value;      // Value of a Literal token
+  string name;  // Name of a Parameter token
+};
+
+// ParameterExpression is an expression over other parameters written in the
+// same postfix notation as the calculator itself, e.g. "a b + 2 *"
+template <typename T>
+class ParameterExpression {
+ public:
+  // Function to parse the tokens of an expression
+  static ParameterExpression parse(const vector<string>& tokens) {
+    return parse<vector<string>>(tokens);
+  }
+
+  // Function to parse the tokens of an expression, given as any range of
+  // strings or string views
+  template <typename Tokens>
+  static ParameterExpression parse(const Tokens& tokens) {
+    ParameterExpression expression;
+    int depth = 0;  // Number of values the expression leaves on its stack
+    for (const auto& token : tokens) {
+      ExpressionToken<T> step{ExpressionToken<T>::Literal, T(0), ""};
+      if (token == "+") {
+        step.kind = ExpressionToken<T>::Add;
+      } else if (token == "-") {
+        step.kind = ExpressionToken<T>::Sub;
+      } else if (token == "*") {
+        step.kind = ExpressionToken<T>::Mul;
+      } else if (token == "/") {
+        step.kind = ExpressionToken<T>::Div;
+      } else if (token == "SQRT") {
+        step.kind = ExpressionToken<T>::Sqrt;
+      } else if (isalpha((unsigned char)token[0])) {
+        step.kind = ExpressionToken<T>::Parameter;
+        step.name = token;
+      } else {
+        step.value = NumericTraits<T>::parse(token);
+      }
+
+      if (step.kind == ExpressionToken<T>::Literal ||
+          step.kind == ExpressionToken<T>::Parameter) {
+        depth++;
+      } else if (step.kind != ExpressionToken<T>::Sqrt) {
+        depth--;
+      }
+      if (depth < 1) break;
+      expression.program.push_back(step);
+      if (!expression.source.empty()) expression.source += ' ';
+      expression.source += token;
+    }
+    if (depth != 1 || expression.program.size() != tokens.size()) {
+      throw invalid_argument("Invalid parameter expression.");
+    }
+    return expression;
+  }
+
+  // Function to list the parameters the expression reads
+  vector<string> dependencies() const {
+    vector<string> names;
+    for (const ExpressionToken<T>& step : program) {
+      if (step.kind == ExpressionToken<T>::Parameter) {
+        names.push_back(step.name);
+      }
+    }
+    return names;
+  }
+
+  // Function to evaluate the expression, looking parameters up with lookup
+  T evaluate(const function<T(const string&)>& lookup) const {
+    vector<T> values;
+    for (const ExpressionToken<T>& step : program) {
+      if (step.kind == ExpressionToken<T>::Literal) {
+        values.push_back(step.value);
+        continue;
+      }
+      if (step.kind == ExpressionToken<T>::Parameter) {
+        values.push_back(lookup(step.name));
+        continue;
+      }
+      if (step.kind == ExpressionToken<T>::Sqrt) {
+        if (values.back() < T(0)) {
+          throw runtime_error(
+              "The number under the SQRT must not be negative");
+        }
+        values.back() = NumericTraits<T>::squareRoot(values.back());
+        continue;
+      }
+      T operand2 = values.back();
+      values.pop_back();
+      T& operand1 = values.back();
+      if (step.kind == ExpressionToken<T>::Add) {
+        operand1 = operand1 + operand2;
+      } else if (step.kind == ExpressionToken<T>::Sub) {
+        operand1 = operand1 - operand2;
+      } else if (step.kind == ExpressionToken<T>::Mul) {
+        operand1 = operand1 * operand2;
+      } else {
+        if (operand2 == T(0)) {
+          throw runtime_error("An attempt to divide by 0.");
+        }
+        operand1 = operand1 / operand2;
+      }
+    }
+    return values.back();
+  }
+
+  const string& text() const { return source; }
+
+ private:
+  vector<ExpressionToken<T>> program;  // Steps in postfix order
+  string source;                       // Expression as it was written
+};
+
+// DerivedParameter is a parameter defined by an expression. Its value is
+// computed on first use and memoized until one of its inputs changes
+template <typename T>
+struct DerivedParameter {
+  ParameterExpression<T> expression;
+  T value = T(0);           // Memoized value
+  bool valid = false;       // Whether value is up to date
+  bool evaluating = false;  // Set while the value is computed, to find cycles
+};
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef REDUCTION_H
+#define REDUCTION_H
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define REDUCTION_X86 1
+#endif
+
+using namespace std;
+
+// Reduction kernels fold a contiguous range of operands into one value. The
+// generic versions keep four independent accumulators, so the loop is not
+// bound by the latency of a single dependency chain; float and double have
+// SSE2 versions and AVX versions that are selected at run time. The order of
+// the additions differs from a chain of '+' commands, so floating-point
+// results may differ in the last bits
+
+template <typename T>
+T reduceSum(const T* data, size_t count) {
+  T acc0 = T(0), acc1 = T(0), acc2 = T(0), acc3 = T(0);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    acc0 = acc0 + data[i];
+    acc1 = acc1 + data[i + 1];
+    acc2 = acc2 + data[i + 2];
+    acc3 = acc3 + data[i + 3];
+  }
+  for (; i < count; i++) acc0 = acc0 + data[i];
+  return (acc0 + acc1) + (acc2 + acc3);
+}
+
+template <typename T>
+T reduceProduct(const T* data, size_t count) {
+  T acc0 = T(1), acc1 = T(1), acc2 = T(1), acc3 = T(1);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    acc0 = acc0 * data[i];
+    acc1 = acc1 * data[i + 1];
+    acc2 = acc2 * data[i + 2];
+    acc3 = acc3 * data[i + 3];
+  }
+  for (; i < count; i++) acc0 = acc0 * data[i];
+  return (acc0 * acc1) * (acc2 * acc3);
+}
+
+// count must be positive for the minimum and the maximum
+template <typename T>
+T reduceMin(const T* data, size_t count) {
+  T acc0 = data[0], acc1 = data[0], acc2 = data[0], acc3 = data[0];
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    acc0 = data[i] < acc0 ? data[i] : acc0;
+    acc1 = data[i + 1] < acc1 ? data[i + 1] : acc1;
+    acc2 = data[i + 2] < acc2 ? data[i + 2] : acc2;
+    acc3 = data[i + 3] < acc3 ? data[i + 3] : acc3;
+  }
+  for (; i < count; i++) acc0 = data[i] < acc0 ? data[i] : acc0;
+  return min(min(acc0, acc1), min(acc2, acc3));
+}
+
+template <typename T>
+T reduceMax(const T* data, size_t count) {
+  T acc0 = data[0], acc1 = data[0], acc2 = data[0], acc3 = data[0];
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    acc0 = acc0 < data[i] ? data[i] : acc0;
+    acc1 = acc1 < data[i + 1] ? data[i + 1] : acc1;
+    acc2 = acc2 < data[i + 2] ? data[i + 2] : acc2;
+    acc3 = acc3 < data[i + 3] ? data[i + 3] : acc3;
+  }
+  for (; i < count; i++) acc0 = acc0 < data[i] ? data[i] : acc0;
+  return max(max(acc0, acc1), max(acc2, acc3));
+}
+
+template <typename T>
+T reduceDot(const T* a, const T* b, size_t count) {
+  T acc0 = T(0), acc1 = T(0), acc2 = T(0), acc3 = T(0);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    acc0 = acc0 + a[i] * b[i];
+    acc1 = acc1 + a[i + 1] * b[i + 1];
+    acc2 = acc2 + a[i + 2] * b[i + 2];
+    acc3 = acc3 + a[i + 3] * b[i + 3];
+  }
+  for (; i < count; i++) acc0 = acc0 + a[i] * b[i];
+  return (acc0 + acc1) + (acc2 + acc3);
+}
+
+#ifdef REDUCTION_X86
+
+namespace simd {
+
+// Checks once whether the processor supports AVX
+inline bool hasAvx() {
+  static const bool supported = __builtin_cpu_supports("avx");
+  return supported;
+}
+
+// Horizontal operations on the lanes of a register
+inline double lanes(__m128d v, double (*op)(double, double)) {
+  return op(_mm_cvtsd_f64(v), _mm_cvtsd_f64(_mm_unpackhi_pd(v, v)));
+}
+
+inline float lanes(__m128 v, float (*op)(float, float)) {
+  float values[4];
+  _mm_storeu_ps(values, v);
+  return op(op(values[0], values[1]), op(values[2], values[3]));
+}
+
+inline double addOp(double a, double b) { return a + b; }
+inline double mulOp(double a, double b) { return a * b; }
+inline double minOp(double a, double b) { return b < a ? b : a; }
+inline double maxOp(double a, double b) { return a < b ? b : a; }
+inline float addOp(float a, float b) { return a + b; }
+inline float mulOp(float a, float b) { return a * b; }
+inline float minOp(float a, float b) { return b < a ? b : a; }
+inline float maxOp(float a, float b) { return a < b ? b : a; }
+
+// Defines the SSE2 and AVX kernels of one reduction for double and float.
+// INIT builds the initial register from the first element, OP combines two
+// registers and SCALAR handles the tail
+#define REDUCTION_KERNELS(NAME, INIT_PD, OP_PD, INIT256_PD, OP256_PD,        \
+                          INIT_PS, OP_PS, INIT256_PS, OP256_PS, SCALAR)      \
+  inline double NAME##Sse2(const double* data, size_t count) {               \
+    __m128d acc0 = INIT_PD, acc1 = INIT_PD;                                  \
+    size_t i = 0;                                                            \
+    for (; i + 4 <= count; i += 4) {                                         \
+      acc0 = OP_PD(acc0, _mm_loadu_pd(data + i));                            \
+      acc1 = OP_PD(acc1, _mm_loadu_pd(data + i + 2));                        \
+    }                                                                        \
+    double result = lanes(OP_PD(acc0, acc1), SCALAR);                       \
+    for (; i < count; i++) result = SCALAR(result, data[i]);                 \
+    return result;                                                           \
+  }                                                                          \
+  __attribute__((target("avx"))) inline double NAME##Avx(const double* data, \
+                                                         size_t count) {     \
+    __m256d acc0 = INIT256_PD, acc1 = INIT256_PD;                            \
+    size_t i = 0;                                                            \
+    for (; i + 8 <= count; i += 8) {                                         \
+      acc0 = OP256_PD(acc0, _mm256_loadu_pd(data + i));                      \
+      acc1 = OP256_PD(acc1, _mm256_loadu_pd(data + i + 4));                  \
+    }                                                                        \
+    __m256d acc = OP256_PD(acc0, acc1);                                      \
+    __m128d half = OP_PD(_mm256_castpd256_pd128(acc),                        \
+                         _mm256_extractf128_pd(acc, 1));                     \
+    double result = lanes(half, SCALAR);                                     \
+    for (; i < count; i++) result = SCALAR(result, data[i]);                 \
+    return result;                                                           \
+  }                                                                          \
+  inline float NAME##Sse2(const float* data, size_t count) {                 \
+    __m128 acc0 = INIT_PS, acc1 = INIT_PS;                                   \
+    size_t i = 0;                                                            \
+    for (; i + 8 <= count; i += 8) {                                         \
+      acc0 = OP_PS(acc0, _mm_loadu_ps(data + i));                            \
+      acc1 = OP_PS(acc1, _mm_loadu_ps(data + i + 4));                        \
+    }                                                                        \
+    float result = lanes(OP_PS(acc0, acc1), SCALAR);                         \
+    for (; i < count; i++) result = SCALAR(result, data[i]);                 \
+    return result;                                                           \
+  }                                                                          \
+  __attribute__((target("avx"))) inline float NAME##Avx(const float* data,   \
+                                                        size_t count) {      \
+    __m256 acc0 = INIT256_PS, acc1 = INIT256_PS;                             \
+    size_t i = 0;                                                            \
+    for (; i + 16 <= count; i += 16) {                                       \
+      acc0 = OP256_PS(acc0, _mm256_loadu_ps(data + i));                      \
+      acc1 = OP256_PS(acc1, _mm256_loadu_ps(data + i + 8));                  \
+    }                                                                        \
+    __m256 acc = OP256_PS(acc0, acc1);                                       \
+    __m128 half = OP_PS(_mm256_castps256_ps128(acc),                         \
+                        _mm256_extractf128_ps(acc, 1));                      \
+    float result = lanes(half, SCALAR);                                      \
+    for (; i < count; i++) result = SCALAR(result, data[i]);                 \
+    return result;                                                           \
+  }
+
+REDUCTION_KERNELS(sum, _mm_setzero_pd(), _mm_add_pd, _mm256_setzero_pd(),
+                  _mm256_add_pd, _mm_setzero_ps(), _mm_add_ps,
+                  _mm256_setzero_ps(), _mm256_add_ps, addOp)
+REDUCTION_KERNELS(product, _mm_set1_pd(1.0), _mm_mul_pd, _mm256_set1_pd(1.0),
+                  _mm256_mul_pd, _mm_set1_ps(1.0f), _mm_mul_ps,
+                  _mm256_set1_ps(1.0f), _mm256_mul_ps, mulOp)
+REDUCTION_KERNELS(min, _mm_set1_pd(data[0]), _mm_min_pd,
+                  _mm256_set1_pd(data[0]), _mm256_min_pd, _mm_set1_ps(data[0]),
+                  _mm_min_ps, _mm256_set1_ps(data[0]), _mm256_min_ps, minOp)
+REDUCTION_KERNELS(max, _mm_set1_pd(data[0]), _mm_max_pd,
+                  _mm256_set1_pd(data[0]), _mm256_max_pd, _mm_set1_ps(data[0]),
+                  _mm_max_ps, _mm256_set1_ps(data[0]), _mm256_max_ps, maxOp)
+
+#undef REDUCTION_KERNELS
+
+inline double dotSse2(const double* a, const double* b, size_t count) {
+  __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i),
+                                       _mm_loadu_pd(b + i)));
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2),
+                                       _mm_loadu_pd(b + i + 2)));
+  }
+  double result = lanes(_mm_add_pd(acc0, acc1), addOp);
+  for (; i < count; i++) result += a[i] * b[i];
+  return result;
+}
+
+__attribute__((target("avx"))) inline double dotAvx(const double* a,
+                                                    const double* b,
+                                                    size_t count) {
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i),
+                                             _mm256_loadu_pd(b + i)));
+    acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4),
+                                             _mm256_loadu_pd(b + i + 4)));
+  }
+  __m256d acc = _mm256_add_pd(acc0, acc1);
+  double result = lanes(_mm_add_pd(_mm256_castpd256_pd128(acc),
+                                   _mm256_extractf128_pd(acc, 1)),
+                        addOp);
+  for (; i < count; i++) result += a[i] * b[i];
+  return result;
+}
+
+inline float dotSse2(const float* a, const float* b, size_t count) {
+  __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i),
+                                       _mm_loadu_ps(b + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+                                       _mm_loadu_ps(b + i + 4)));
+  }
+  float result = lanes(_mm_add_ps(acc0, acc1), addOp);
+  for (; i < count; i++) result += a[i] * b[i];
+  return result;
+}
+
+__attribute__((target("avx"))) inline float dotAvx(const float* a,
+                                                   const float* b,
+                                                   size_t count) {
+  __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i),
+                                             _mm256_loadu_ps(b + i)));
+    acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8),
+                                             _mm256_loadu_ps(b + i + 8)));
+  }
+  __m256 acc = _mm256_add_ps(acc0, acc1);
+  float result = lanes(_mm_add_ps(_mm256_castps256_ps128(acc),
+                                  _mm256_extractf128_ps(acc, 1)),
+                       addOp);
+  for (; i < count; i++) result += a[i] * b[i];
+  return result;
+}
+
+}  // namespace simd
+
+// Specializations that dispatch to the vectorized kernels
+#define REDUCTION_DISPATCH(FUNCTION, KERNEL, TYPE)                     \
+  template <>                                                          \
+  inline TYPE FUNCTION<TYPE>(const TYPE* data, size_t count) {         \
+    return simd::hasAvx() ? simd::KERNEL##Avx(data, count)             \
+                          : simd::KERNEL##Sse2(data, count);           \
+  }
+
+REDUCTION_DISPATCH(reduceSum, sum, double)
+REDUCTION_DISPATCH(reduceSum, sum, float)
+REDUCTION_DISPATCH(reduceProduct, product, double)
+REDUCTION_DISPATCH(reduceProduct, product, float)
+REDUCTION_DISPATCH(reduceMin, min, double)
+REDUCTION_DISPATCH(reduceMin, min, float)
+REDUCTION_DISPATCH(reduceMax, max, double)
+REDUCTION_DISPATCH(reduceMax, max, float)
+
+#undef REDUCTION_DISPATCH
+
+template <>
+inline double reduceDot<double>(const double* a, const double* b,
+                                size_t count) {
+  return simd::hasAvx() ? simd::dotAvx(a, b, count)
+                        : simd::dotSse2(a, b, count);
+}
+
+template <>
+inline float reduceDot<float>(const float* a, const float* b, size_t count) {
+  return simd::hasAvx() ? simd::dotAvx(a, b, count)
+                        : simd::dotSse2(a, b, count);
+}
+
+#endif
+
+#endif
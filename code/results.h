@@ -0,0 +1,211 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// A result file holds the values printed by PRINT as raw little-endian
+// doubles after a 24-byte header, so a consumer can map it and use it as an
+// array:
+//
+//   "CALCRES1" uint32 version uint32 valueSize uint64 count
+//
+// count is kUnknownResultCount if the file was written to a pipe; the
+// values then run to the end of the file. The optional index file has the
+// same header with the magic "CALCIDX1" and holds the uint64 input line
+// number of every result
+const char kResultMagic[8] = {'C', 'A', 'L', 'C', 'R', 'E', 'S', '1'};
+const char kResultIndexMagic[8] = {'C', 'A', 'L', 'C', 'I', 'D', 'X', '1'};
+const uint32_t kResultVersion = 1;
+const size_t kResultHeaderSize = 24;
+const uint64_t kUnknownResultCount = UINT64_MAX;
+
+// Function to convert a 64-bit word to little-endian byte order
+inline uint64_t toLittleEndian(uint64_t word) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return __builtin_bswap64(word);
+#else
+  return word;
+#endif
+}
+
+// ResultWriter appends results to a result file and its index. Results are
+// collected in batches of kBatchSize, so the file is written with few
+// system calls
+class ResultWriter {
+ public:
+  static const size_t kBatchSize = 8192;
+
+  ResultWriter() = default;
+  ResultWriter(const ResultWriter&) = delete;
+  ResultWriter& operator=(const ResultWriter&) = delete;
+  ~ResultWriter() { close(); }
+
+  // Function to open the result file, "-" for standard output, and the
+  // index file if indexPath is not empty
+  bool open(const string& path, const string& indexPath = "") {
+    valuesFd = openOutput(path);
+    if (valuesFd < 0) return false;
+    if (!indexPath.empty()) {
+      indexFd = openOutput(indexPath);
+      if (indexFd < 0) return false;
+    }
+    failed = !writeHeader(valuesFd, kResultMagic, kUnknownResultCount) ||
+             (indexFd >= 0 &&
+              !writeHeader(indexFd, kResultIndexMagic, kUnknownResultCount));
+    values.reserve(kBatchSize);
+    if (indexFd >= 0) lines.reserve(kBatchSize);
+    return !failed;
+  }
+
+  // Function to append a result printed by the given input line
+  void append(double value, uint64_t line) {
+    uint64_t word;
+    memcpy(&word, &value, sizeof(word));
+    values.push_back(toLittleEndian(word));
+    if (indexFd >= 0) lines.push_back(toLittleEndian(line));
+    count++;
+    if (values.size() == kBatchSize) flush();
+  }
+
+  // Function to write the buffered results
+  void flush() {
+    if (!writeAll(valuesFd, values.data(), values.size() * sizeof(uint64_t)) ||
+        !writeAll(indexFd, lines.data(), lines.size() * sizeof(uint64_t))) {
+      failed = true;
+    }
+    values.clear();
+    lines.clear();
+  }
+
+  // Function to write the remaining results and store the number of results
+  // in the headers of regular files. Returns false if a write failed
+  bool close() {
+    if (valuesFd < 0) return !failed;
+    flush();
+    for (int fd : {valuesFd, indexFd}) {
+      if (fd < 0) continue;
+      struct stat status;
+      if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode)) {
+        uint64_t stored = toLittleEndian(count);
+        if (pwrite(fd, &stored, sizeof(stored), 16) != sizeof(stored)) {
+          failed = true;
+        }
+      }
+      if (fd != STDOUT_FILENO) ::close(fd);
+    }
+    valuesFd = indexFd = -1;
+    return !failed;
+  }
+
+  uint64_t getCount() const { return count; }
+
+ private:
+  int valuesFd = -1;
+  int indexFd = -1;
+  vector<uint64_t> values;  // Buffered results in file byte order
+  vector<uint64_t> lines;   // Buffered line numbers in file byte order
+  uint64_t count = 0;
+  bool failed = false;
+
+  static int openOutput(const string& path) {
+    if (path == "-") return STDOUT_FILENO;
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+
+  static bool writeHeader(int fd, const char* magic, uint64_t count) {
+    char header[kResultHeaderSize];
+    uint32_t version = kResultVersion;
+    uint32_t valueSize = sizeof(uint64_t);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    version = __builtin_bswap32(version);
+    valueSize = __builtin_bswap32(valueSize);
+#endif
+    count = toLittleEndian(count);
+    memcpy(header, magic, 8);
+    memcpy(header + 8, &version, 4);
+    memcpy(header + 12, &valueSize, 4);
+    memcpy(header + 16, &count, 8);
+    return writeAll(fd, header, sizeof(header));
+  }
+
+  static bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+      ssize_t written = write(fd, bytes, size);
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        return false;
+      }
+      bytes += written;
+      size -= written;
+    }
+    return true;
+  }
+};
+
+// MappedResults maps a result file into memory and exposes its values as an
+// array. Throws runtime_error if the file is not a result file
+class MappedResults {
+ public:
+  explicit MappedResults(const string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("Unable to open results " + path + ".");
+    struct stat status;
+    if (fstat(fd, &status) != 0 ||
+        size_t(status.st_size) < kResultHeaderSize) {
+      ::close(fd);
+      throw runtime_error("Invalid result file.");
+    }
+    length = status.st_size;
+    mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+      throw runtime_error("Unable to map results " + path + ".");
+    }
+
+    const char* bytes = static_cast<const char*>(mapping);
+    uint64_t stored;
+    memcpy(&stored, bytes + 16, sizeof(stored));
+    stored = toLittleEndian(stored);
+    size_t available = (length - kResultHeaderSize) / sizeof(double);
+    if (memcmp(bytes, kResultMagic, 8) != 0 ||
+        (stored != kUnknownResultCount && stored > available)) {
+      munmap(mapping, length);
+      throw runtime_error("Invalid result file.");
+    }
+    count = stored == kUnknownResultCount ? available : stored;
+  }
+
+  MappedResults(const MappedResults&) = delete;
+  MappedResults& operator=(const MappedResults&) = delete;
+  ~MappedResults() { munmap(mapping, length); }
+
+  // Values of the file, valid on little-endian hosts
+  const double* data() const {
+    return reinterpret_cast<const double*>(static_cast<const char*>(mapping) +
+                                           kResultHeaderSize);
+  }
+
+  size_t size() const { return count; }
+
+  double operator[](size_t index) const { return data()[index]; }
+
+ private:
+  void* mapping;
+  size_t length;
+  size_t count;
+};
+
+#endif
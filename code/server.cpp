@@ -0,0 +1,311 @@
+#include "server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#include "calculator.h"
+#include "session.h"
+using namespace std;
+
+namespace {
+
+const int kMaxEvents = 64;        // Events fetched by a single epoll_wait call
+const size_t kReadChunk = 65536;  // Bytes read from a socket at a time
+
+const size_t kMaxLineLength = 1 << 20;     // Longest line a client may send
+const size_t kMaxPendingOutput = 1 << 20;  // Unwritten replies of a client
+
+volatile sig_atomic_t stopRequested = 0;  // Set by SIGINT or SIGTERM
+
+void requestStop(int) { stopRequested = 1; }
+
+// Connection holds the state of a single client of the server. Its commands
+// are executed by a session coroutine that is suspended while the client
+// has not sent a complete line
+struct Connection {
+  ExecutionContext context;  // Isolated calculator state of this client
+  ostringstream replies;     // Output produced by the current batch
+  SessionInput input;        // Received bytes not yet processed
+  SessionTask session;       // Executes the lines of the client
+  string pending;            // Replies not yet written to the socket
+  bool closing = false;      // No more commands will be processed
+  uint32_t interest = EPOLLIN | EPOLLRDHUP;  // Events registered for the socket
+
+  Connection(const ExecutionLimits& limits, Tracer* tracer) {
+    context.output = &replies;
+    context.errors = &replies;
+    context.governor.limits = limits;
+    context.tracer = tracer;
+    session = executeSession(input, context);
+  }
+};
+
+// Fills the sockaddr_un structure for the given socket path
+bool makeAddress(const string& socketPath, sockaddr_un& address) {
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    cerr << "Error: Socket path is too long." << endl;
+    return false;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+  return true;
+}
+
+// Resumes the session of the connection with the received lines. If the
+// client has closed its side, the trailing line without a newline is
+// executed as well. A client whose unfinished line exceeds kMaxLineLength
+// gets an error and is disconnected
+void processInput(Connection& connection, bool endOfInput) {
+  if (endOfInput) connection.input.close();
+  connection.input.wake();
+  connection.closing = connection.session.done();
+
+  connection.pending += connection.replies.str();
+  connection.replies.str("");
+  if (!connection.closing && connection.input.getBuffered() > kMaxLineLength) {
+    connection.pending += "Error: Line is too long.\n";
+    connection.closing = true;
+  }
+}
+
+// Writes as much of the pending output as the socket accepts. Returns false
+// if the connection has failed and must be dropped
+bool flushOutput(int fd, Connection& connection) {
+  size_t written = 0;
+  while (written < connection.pending.size()) {
+    ssize_t n = send(fd, connection.pending.data() + written,
+                     connection.pending.size() - written, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      return false;
+    }
+    written += n;
+  }
+  connection.pending.erase(0, written);
+  return true;
+}
+
+// Registers the events the connection waits for: EPOLLOUT while output is
+// waiting to be written, and input while the connection takes commands and
+// has less than kMaxPendingOutput bytes of replies. A client that does not
+// read its replies is thus not read from until they are written
+void updateInterest(int epollFd, int fd, Connection& connection) {
+  uint32_t interest = 0;
+  if (!connection.closing && connection.pending.size() < kMaxPendingOutput) {
+    interest |= EPOLLIN | EPOLLRDHUP;
+  }
+  if (!connection.pending.empty()) interest |= EPOLLOUT;
+  if (interest == connection.interest) return;
+  epoll_event event{};
+  event.events = interest;
+  event.data.fd = fd;
+  epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+  connection.interest = interest;
+}
+
+// Accepts every connection waiting on the listening socket
+void acceptClients(int epollFd, int listenFd, const ExecutionLimits& limits,
+                   Tracer* tracer,
+                   unordered_map<int, unique_ptr<Connection>>& connections) {
+  while (true) {
+    int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      return;  // EAGAIN: no more pending connections
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      close(fd);
+      continue;
+    }
+    connections[fd] = make_unique<Connection>(limits, tracer);
+  }
+}
+
+// Handles readiness of a client socket. Returns false if the connection is
+// finished and must be closed
+bool serveClient(int epollFd, int fd, uint32_t events,
+                 Connection& connection) {
+  if (events & EPOLLERR) return false;
+
+  if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+    // The lines of every chunk are executed before the next one is read, so
+    // only an unfinished line stays buffered
+    char buffer[kReadChunk];
+    bool endOfInput = false;
+    while (!connection.closing &&
+           connection.pending.size() < kMaxPendingOutput) {
+      ssize_t n = read(fd, buffer, sizeof(buffer));
+      if (n > 0) {
+        connection.input.append(buffer, n);
+        processInput(connection, false);
+        continue;
+      }
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+      endOfInput = true;  // The client has closed its side or failed
+      break;
+    }
+    if (endOfInput) processInput(connection, true);
+  }
+
+  if (!flushOutput(fd, connection)) return false;
+  if (connection.closing && connection.pending.empty()) return false;
+  updateInterest(epollFd, fd, connection);
+  return true;
+}
+
+}  // namespace
+
+// Function to serve calculator clients on a Unix domain socket
+int runServer(const string& socketPath, const ExecutionLimits& limits,
+              Tracer* tracer) {
+  // The socket is bound under a temporary name and renamed once it listens,
+  // so clients never see a socket file that refuses connections
+  string bindPath = socketPath + ".tmp";
+  sockaddr_un address;
+  if (!makeAddress(bindPath, address)) return 1;
+
+  int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd < 0) {
+    cerr << "Error: Unable to create socket: " << strerror(errno) << endl;
+    return 1;
+  }
+  unlink(bindPath.c_str());  // Remove a stale socket of a previous run
+  if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) <
+          0 ||
+      listen(listenFd, SOMAXCONN) < 0 ||
+      rename(bindPath.c_str(), socketPath.c_str()) < 0) {
+    cerr << "Error: Unable to listen on " << socketPath << ": "
+         << strerror(errno) << endl;
+    close(listenFd);
+    unlink(bindPath.c_str());
+    return 1;
+  }
+
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  epoll_event listenEvent{};
+  listenEvent.events = EPOLLIN;
+  listenEvent.data.fd = listenFd;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent);
+
+  struct sigaction action {};
+  action.sa_handler = requestStop;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  unordered_map<int, unique_ptr<Connection>> connections;
+  epoll_event events[kMaxEvents];
+  while (!stopRequested) {
+    int ready = epoll_wait(epollFd, events, kMaxEvents, -1);
+    if (ready < 0) {
+      if (errno == EINTR) continue;
+      cerr << "Error: epoll_wait failed: " << strerror(errno) << endl;
+      break;
+    }
+    for (int i = 0; i < ready; i++) {
+      int fd = events[i].data.fd;
+      if (fd == listenFd) {
+        acceptClients(epollFd, listenFd, limits, tracer, connections);
+        continue;
+      }
+      auto it = connections.find(fd);
+      if (it == connections.end()) continue;
+      if (!serveClient(epollFd, fd, events[i].events, *it->second)) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections.erase(it);
+      }
+    }
+  }
+
+  for (auto& connection : connections) close(connection.first);
+  close(epollFd);
+  close(listenFd);
+  unlink(socketPath.c_str());
+  return 0;
+}
+
+// Function to send standard input to a server and print its replies
+int runClient(const string& socketPath) {
+  sockaddr_un address;
+  if (!makeAddress(socketPath, address)) return 1;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 ||
+      connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) <
+          0) {
+    cerr << "Error: Unable to connect to " << socketPath << ": "
+         << strerror(errno) << endl;
+    if (fd >= 0) close(fd);
+    return 1;
+  }
+  // The server stops reading from a client whose replies are not read, so
+  // the socket is non-blocking and replies are read while input is sent
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  signal(SIGPIPE, SIG_IGN);
+
+  pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {fd, POLLIN, 0}};
+  char buffer[kReadChunk];
+  string unsent;  // Input read from stdin that the server has not taken yet
+  size_t sent = 0;
+  bool inputOpen = true;
+  while (true) {
+    // Standard input is read only once the previous chunk has been sent
+    bool sending = sent < unsent.size();
+    fds[0].fd = inputOpen && !sending ? STDIN_FILENO : -1;
+    fds[1].events = sending ? POLLIN | POLLOUT : POLLIN;
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (fds[0].revents) {
+      ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+      if (n > 0) {
+        unsent.assign(buffer, n);
+        sent = 0;
+      } else if (n == 0 || errno != EINTR) {
+        inputOpen = false;
+        shutdown(fd, SHUT_WR);
+      }
+    }
+    if (sent < unsent.size()) {
+      ssize_t w = send(fd, unsent.data() + sent, unsent.size() - sent,
+                       MSG_NOSIGNAL);
+      if (w > 0) {
+        sent += w;
+      } else if (w < 0 && errno != EAGAIN && errno != EINTR) {
+        // The server has stopped reading; its last replies are still read
+        inputOpen = false;
+        unsent.clear();
+        sent = 0;
+      }
+    }
+    if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+      ssize_t n = read(fd, buffer, sizeof(buffer));
+      if (n > 0) {
+        cout.write(buffer, n);
+        cout.flush();
+      } else if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+        break;  // The server has closed the connection
+      }
+    }
+  }
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+
+#include "governor.h"
+#include "tracer.h"
+
+using namespace std;
+
+// Runs the calculator as a daemon listening on a Unix domain socket. Every
+// connection gets its own ExecutionContext with the given limits (and
+// tracer, if any), commands
+// are read line by line and the output of each batch is sent back on the
+// same connection. Returns the process exit code once the server is stopped
+// by SIGINT or SIGTERM.
+int runServer(const string& socketPath,
+              const ExecutionLimits& limits = ExecutionLimits(),
+              Tracer* tracer = nullptr);
+
+// Connects to a running server, forwards standard input to it and copies the
+// replies to standard output until the server closes the connection
+int runClient(const string& socketPath);
+
+#endif
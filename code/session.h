@@ -0,0 +1,143 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string>
+
+#include "calculator.h"
+
+using namespace std;
+
+// SessionTask owns the coroutine of a script session. The session starts
+// running as soon as it is created and stays suspended at its end until the
+// task is destroyed, so done() tells whether the session has finished
+class SessionTask {
+ public:
+  struct promise_type {
+    SessionTask get_return_object() {
+      return SessionTask(coroutine_handle<promise_type>::from_promise(*this));
+    }
+    suspend_never initial_suspend() noexcept { return {}; }
+    suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { terminate(); }  // Commands report errors
+  };
+
+  SessionTask() = default;
+  SessionTask(SessionTask&& other) noexcept : handle(other.handle) {
+    other.handle = nullptr;
+  }
+  SessionTask& operator=(SessionTask&& other) noexcept {
+    if (this != &other) {
+      if (handle) handle.destroy();
+      handle = other.handle;
+      other.handle = nullptr;
+    }
+    return *this;
+  }
+  ~SessionTask() {
+    if (handle) handle.destroy();
+  }
+
+  bool done() const { return !handle || handle.done(); }
+
+ private:
+  coroutine_handle<promise_type> handle;
+
+  explicit SessionTask(coroutine_handle<promise_type> handle)
+      : handle(handle) {}
+};
+
+// SessionInput buffers the bytes received for a session and hands them to
+// the session line by line. A session that asks for a line which has not
+// arrived yet is suspended until wake() finds one
+class SessionInput {
+ public:
+  // Awaiter returned by nextLine(). Resumes with the next line, or with no
+  // value once the input is closed and exhausted
+  class LineAwaiter {
+   public:
+    explicit LineAwaiter(SessionInput& input) : input(input) {}
+    bool await_ready() const { return input.hasLine(); }
+    void await_suspend(coroutine_handle<> session) { input.waiting = session; }
+    optional<string> await_resume() { return input.takeLine(); }
+
+   private:
+    SessionInput& input;
+  };
+
+  LineAwaiter nextLine() { return LineAwaiter(*this); }
+
+  // Whether nextLine() resumes without waiting for more input
+  bool hasLine() const {
+    return closed || buffer.find('\n', start) != string::npos;
+  }
+
+  // Function to add received bytes
+  void append(const char* data, size_t size) {
+    buffer.erase(0, start);  // Drop the lines the session has read
+    start = 0;
+    buffer.append(data, size);
+  }
+
+  // Number of received bytes the session has not read yet
+  size_t getBuffered() const { return buffer.size() - start; }
+
+  // Function to mark the end of the input
+  void close() { closed = true; }
+
+  // Function to resume the waiting session if its line has arrived. The
+  // session runs until it needs input that has not arrived or finishes
+  void wake() {
+    if (!waiting || !hasLine()) return;
+    coroutine_handle<> session = waiting;
+    waiting = nullptr;
+    session.resume();
+  }
+
+ private:
+  string buffer;
+  size_t start = 0;  // Offset of the first unread byte
+  bool closed = false;
+  coroutine_handle<> waiting;
+
+  optional<string> takeLine() {
+    size_t newline = buffer.find('\n', start);
+    string line;
+    if (newline != string::npos) {
+      line = buffer.substr(start, newline - start);
+      start = newline + 1;
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+    } else if (start < buffer.size()) {  // Last line without a newline
+      line = buffer.substr(start);
+      start = buffer.size();
+    } else {
+      return nullopt;
+    }
+    if (start == buffer.size()) {
+      buffer.clear();
+      start = 0;
+    }
+    return line;
+  }
+};
+
+// Function to execute the lines of a session against its context. The
+// coroutine suspends whenever it waits for input, so a single thread can
+// interleave many sessions
+template <typename T>
+SessionTask executeSession(SessionInput& input,
+                           BasicExecutionContext<T>& context) {
+  while (true) {
+    // Waiting for input does not count against the time limit
+    if (!input.hasLine()) context.governor.pause();
+    optional<string> line = co_await input.nextLine();
+    if (!line || *line == "exit") co_return;
+    if (context.tracer != nullptr) context.tracer->beginLine();
+    processCommand(*line, context);
+  }
+}
+
+#endif
@@ -0,0 +1,344 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "calculator.h"
+
+using namespace std;
+
+// A snapshot is a binary image of an execution context together with the
+// number of input lines that produced it. All integers are stored in the
+// byte order of the machine:
+//
+//   "CALCSNAP" uint32 version uint32 valueSize uint32 valueKind
+//   uint64 lines
+//   uint64 count, count values                    operand stack, bottom first
+//   uint64 count, count (name, value)             defined parameters
+//   uint64 count, count (name, text, uint8 valid, value)  derived parameters
+//
+// Strings are a uint32 length followed by the bytes
+const char kSnapshotMagic[8] = {'C', 'A', 'L', 'C', 'S', 'N', 'A', 'P'};
+const uint32_t kSnapshotVersion = 1;
+
+// SnapshotEncoder appends the fields of a snapshot to a buffer
+class SnapshotEncoder {
+ public:
+  vector<char> bytes;
+
+  template <typename V>
+  void put(const V& value) {
+    static_assert(is_trivially_copyable<V>::value,
+                  "Snapshot fields must be trivially copyable");
+    const char* begin = reinterpret_cast<const char*>(&value);
+    bytes.insert(bytes.end(), begin, begin + sizeof(V));
+  }
+
+  void putString(const string& text) {
+    put(uint32_t(text.size()));
+    bytes.insert(bytes.end(), text.begin(), text.end());
+  }
+};
+
+// SnapshotDecoder reads the fields of a snapshot from memory and throws if
+// the snapshot ends early
+class SnapshotDecoder {
+ public:
+  SnapshotDecoder(const char* data, size_t size) : data(data), size(size) {}
+
+  template <typename V>
+  V get() {
+    V value;
+    memcpy(&value, take(sizeof(V)), sizeof(V));
+    return value;
+  }
+
+  string getString() {
+    uint32_t length = get<uint32_t>();
+    return string(take(length), length);
+  }
+
+  bool atEnd() const { return offset == size; }
+
+ private:
+  const char* data;
+  size_t size;
+  size_t offset = 0;
+
+  const char* take(size_t count) {
+    if (count > size - offset) invalid();
+    offset += count;
+    return data + offset - count;
+  }
+
+  [[noreturn]] static void invalid() {
+    throw runtime_error("Invalid snapshot file.");
+  }
+};
+
+// Function to tell numeric types of the same size apart in a snapshot
+template <typename T>
+uint32_t snapshotValueKind() {
+  return is_floating_point<T>::value ? 1 : 2;
+}
+
+// Function to encode the state of a context after the given number of lines
+template <typename T>
+vector<char> encodeSnapshot(const BasicExecutionContext<T>& context,
+                            uint64_t lines) {
+  SnapshotEncoder encoder;
+  encoder.bytes.insert(encoder.bytes.end(), kSnapshotMagic,
+                       kSnapshotMagic + sizeof(kSnapshotMagic));
+  encoder.put(kSnapshotVersion);
+  encoder.put(uint32_t(sizeof(T)));
+  encoder.put(snapshotValueKind<T>());
+  encoder.put(lines);
+
+  encoder.put(uint64_t(context.operandStack.size()));
+  const T* values = context.operandStack.data();
+  for (size_t i = 0; i < context.operandStack.size(); i++) {
+    encoder.put(values[i]);
+  }
+  encoder.put(uint64_t(context.definedParameters.size()));
+  for (const auto& parameter : context.definedParameters) {
+    encoder.putString(parameter.first);
+    encoder.put(parameter.second);
+  }
+  encoder.put(uint64_t(context.derivedParameters.size()));
+  for (const auto& parameter : context.derivedParameters) {
+    encoder.putString(parameter.first);
+    encoder.putString(parameter.second.expression.text());
+    encoder.put(uint8_t(parameter.second.valid));
+    encoder.put(parameter.second.value);
+  }
+  return encoder.bytes;
+}
+
+// Function to replace the state of a context with a snapshot in memory.
+// Returns the number of input lines the snapshot was taken after
+template <typename T>
+uint64_t decodeSnapshot(const char* data, size_t size,
+                        BasicExecutionContext<T>& context) {
+  SnapshotDecoder decoder(data, size);
+  char magic[sizeof(kSnapshotMagic)];
+  for (char& byte : magic) byte = decoder.get<char>();
+  if (memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0 ||
+      decoder.get<uint32_t>() != kSnapshotVersion) {
+    throw runtime_error("Invalid snapshot file.");
+  }
+  if (decoder.get<uint32_t>() != sizeof(T) ||
+      decoder.get<uint32_t>() != snapshotValueKind<T>()) {
+    throw runtime_error("The snapshot was taken with another numeric type.");
+  }
+  uint64_t lines = decoder.get<uint64_t>();
+
+  BasicExecutionContext<T> restored;
+  for (uint64_t count = decoder.get<uint64_t>(); count > 0; count--) {
+    restored.operandStack.push(decoder.get<T>());
+  }
+  for (uint64_t count = decoder.get<uint64_t>(); count > 0; count--) {
+    string name = decoder.getString();
+    restored.definedParameters[name] = decoder.get<T>();
+  }
+  vector<pair<string, DerivedParameter<T>>> derived;
+  for (uint64_t count = decoder.get<uint64_t>(); count > 0; count--) {
+    string name = decoder.getString();
+    istringstream text(decoder.getString());
+    DerivedParameter<T> parameter;
+    parameter.expression = ParameterExpression<T>::parse(vector<string>{
+        istream_iterator<string>{text}, istream_iterator<string>{}});
+    parameter.valid = decoder.get<uint8_t>() != 0;
+    parameter.value = decoder.get<T>();
+    restored.defineExpression(name, parameter.expression);
+    derived.emplace_back(name, parameter);
+  }
+  if (!decoder.atEnd()) throw runtime_error("Invalid snapshot file.");
+  // Memoized values are restored after all the expressions are defined,
+  // since defining an expression invalidates its dependents
+  for (const auto& parameter : derived) {
+    restored.derivedParameters[parameter.first] = parameter.second;
+  }
+
+  context.operandStack = move(restored.operandStack);
+  context.definedParameters = move(restored.definedParameters);
+  context.derivedParameters = move(restored.derivedParameters);
+  context.parameterDependents = move(restored.parameterDependents);
+  return lines;
+}
+
+// Function to map a snapshot file into memory and restore a context from it.
+// Returns the number of input lines the snapshot was taken after
+template <typename T>
+uint64_t loadSnapshot(const string& path, BasicExecutionContext<T>& context) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw runtime_error("Unable to open snapshot " + path + ".");
+  struct stat status;
+  if (fstat(fd, &status) != 0 || status.st_size == 0) {
+    close(fd);
+    throw runtime_error("Invalid snapshot file.");
+  }
+  size_t size = status.st_size;
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw runtime_error("Unable to map snapshot " + path + ".");
+  }
+  try {
+    uint64_t lines = decodeSnapshot(static_cast<const char*>(data), size,
+                                    context);
+    munmap(data, size);
+    return lines;
+  } catch (...) {
+    munmap(data, size);
+    throw;
+  }
+}
+
+// SnapshotWriter writes snapshots to a file on a background thread. A new
+// snapshot replaces one that has not been written yet, so submit() never
+// waits for the disk. Every snapshot is written to a temporary file that is
+// renamed over the previous one, so the file always holds a whole snapshot
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(const string& path) : path(path) {}
+
+  ~SnapshotWriter() {
+    flush();
+    {
+      lock_guard<mutex> lock(stateMutex);
+      stopping = true;
+    }
+    stateChanged.notify_all();
+    if (worker.joinable()) worker.join();
+  }
+
+  // Function to queue a snapshot for writing
+  void submit(vector<char> snapshot) {
+    {
+      lock_guard<mutex> lock(stateMutex);
+      queued = move(snapshot);
+      hasQueued = true;
+      if (!worker.joinable()) worker = thread([this] { run(); });
+    }
+    stateChanged.notify_all();
+  }
+
+  // Function to wait until the queued snapshot is written
+  void flush() {
+    unique_lock<mutex> lock(stateMutex);
+    stateChanged.wait(lock, [this] { return !hasQueued && !writing; });
+  }
+
+  // Whether the last written snapshot reached the file
+  bool succeeded() const {
+    lock_guard<mutex> lock(stateMutex);
+    return lastWriteSucceeded;
+  }
+
+ private:
+  string path;
+  thread worker;
+  mutable mutex stateMutex;
+  condition_variable stateChanged;
+  vector<char> queued;
+  bool hasQueued = false;
+  bool writing = false;
+  bool stopping = false;
+  bool lastWriteSucceeded = true;
+
+  void run() {
+    unique_lock<mutex> lock(stateMutex);
+    while (true) {
+      stateChanged.wait(lock, [this] { return hasQueued || stopping; });
+      if (!hasQueued) return;
+      vector<char> snapshot = move(queued);
+      hasQueued = false;
+      writing = true;
+      lock.unlock();
+      bool written = writeFile(snapshot);
+      lock.lock();
+      writing = false;
+      lastWriteSucceeded = written;
+      stateChanged.notify_all();
+    }
+  }
+
+  bool writeFile(const vector<char>& snapshot) const {
+    string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t offset = 0;
+    while (offset < snapshot.size()) {
+      ssize_t count =
+          write(fd, snapshot.data() + offset, snapshot.size() - offset);
+      if (count < 0) {
+        if (errno == EINTR) continue;
+        close(fd);
+        return false;
+      }
+      offset += count;
+    }
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced && rename(temporary.c_str(), path.c_str()) == 0;
+  }
+};
+
+// Checkpointer takes a snapshot of a context every `every` input lines, so a
+// long job can resume after a restart. The state is encoded on the calling
+// thread, which is a plain copy, and written by a SnapshotWriter
+class Checkpointer {
+ public:
+  Checkpointer(const string& path, size_t every)
+      : path(path), every(every == 0 ? 1 : every), writer(path) {}
+
+  // Function to restore a context from the last snapshot, if there is one.
+  // Returns the number of input lines to skip
+  template <typename T>
+  uint64_t restore(BasicExecutionContext<T>& context) {
+    if (access(path.c_str(), F_OK) != 0) return 0;
+    lines = loadSnapshot(path, context);
+    return lines;
+  }
+
+  // Function to account for executed input lines
+  template <typename T>
+  void linesExecuted(const BasicExecutionContext<T>& context,
+                     size_t count = 1) {
+    uint64_t before = lines;
+    lines += count;
+    if (lines / every != before / every) {
+      writer.submit(encodeSnapshot(context, lines));
+    }
+  }
+
+  // Function to write the final snapshot and wait until it is stored.
+  // Returns false if it could not be written
+  template <typename T>
+  bool finish(const BasicExecutionContext<T>& context) {
+    writer.submit(encodeSnapshot(context, lines));
+    writer.flush();
+    return writer.succeeded();
+  }
+
+  uint64_t getLinesExecuted() const { return lines; }
+
+ private:
+  string path;
+  size_t every;
+  uint64_t lines = 0;  // Input lines executed, including restored ones
+  SnapshotWriter writer;
+};
+
+#endif
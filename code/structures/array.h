@@ -1,21 +1,92 @@
 #ifndef ARRAY_H
 #define ARRAY_H
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "array_simd.h"
 using namespace std;
 
+// Array is a dynamic array of elements of type T. The storage grows
+// geometrically, so adding elements takes amortized O(1) time. Elements of
+// trivially copyable types are shifted and relocated with memmove/memcpy.
+// After sort() the array is in sorted mode: add() and insert() keep the
+// elements ordered and search() is a binary search. In gap buffer mode the
+// free space is kept at the last edited index instead of the end, so inserts
+// and removals clustered around that index move few elements
+template <typename T = int>
 class Array {
  private:
-  int maxLen;
-  int* data;
-  int size;
+  T* data = nullptr;
+  int capacity = 0;
+  int size = 0;
   int printErrors = 1;  // A flag to control error message printing
+  bool sorted = false;  // Elements are kept in ascending order
+  bool gapBuffer = false;
+  int gapStart = 0;  // Index of the first free slot in gap buffer mode
 
  public:
-  Array(int maxLen = 100) : size(0), maxLen(maxLen) { data = new int[maxLen]; }
+  Array(int capacity = 0) { reserve(capacity); }
+
+  Array(const Array& other)
+      : printErrors(other.printErrors),
+        sorted(other.sorted),
+        gapBuffer(other.gapBuffer) {
+    reserve(other.size);
+    for (; size < other.size; size++) new (data + size) T(other.at(size));
+    gapStart = size;
+  }
+
+  Array(Array&& other) noexcept
+      : data(other.data),
+        capacity(other.capacity),
+        size(other.size),
+        printErrors(other.printErrors),
+        sorted(other.sorted),
+        gapBuffer(other.gapBuffer),
+        gapStart(other.gapStart) {
+    other.data = nullptr;
+    other.capacity = 0;
+    other.size = 0;
+    other.gapStart = 0;
+  }
+
+  Array& operator=(const Array& other) {
+    if (this != &other) {
+      Array copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
 
-  ~Array() { delete[] data; }
+  Array& operator=(Array&& other) noexcept {
+    if (this != &other) {
+      Array moved(std::move(other));
+      swap(moved);
+    }
+    return *this;
+  }
+
+  ~Array() {
+    clear();
+    allocator<T>().deallocate(data, capacity);
+  }
+
+  void swap(Array& other) noexcept {
+    std::swap(data, other.data);
+    std::swap(capacity, other.capacity);
+    std::swap(size, other.size);
+    std::swap(printErrors, other.printErrors);
+    std::swap(sorted, other.sorted);
+    std::swap(gapBuffer, other.gapBuffer);
+    std::swap(gapStart, other.gapStart);
+  }
 
   void setPrintErrorsFalse() { printErrors = 0; }
 
@@ -23,29 +94,124 @@ class Array {
 
   int getPrintErrors() const { return printErrors; }
 
-  int getMaxLen() const { return maxLen; }
+  int getSize() const { return size; }
+
+  int getCapacity() const { return capacity; }
+
+  bool isSorted() const { return sorted; }
+
+  void setGapBufferTrue();
+
+  void setGapBufferFalse();
+
+  bool getGapBuffer() const { return gapBuffer; }
+
+  // The array has no maximum length any more; this is its current capacity
+  int getMaxLen() const { return capacity; }
+
+  void reserve(int newCapacity);
+  void shrink_to_fit();
+  void clear();
+
+  int add(T element);
+  int insert(int index, T element);
+  template <typename... Args>
+  int emplace(int index, Args&&... args);
+  T removeLast();
+  T removeAtIndex(int index);
+  T get(int index) const;
+  T change(int index, T element);
+  int search(const T& element) const;
+  int count(const T& element) const;
+  T min() const;
+  T max() const;
+  void sort();
+
+ private:
+  static constexpr bool kTrivial = is_trivially_copyable<T>::value;
+
+  // Value returned by functions that fail
+  static T errorValue() {
+    if constexpr (is_arithmetic<T>::value) {
+      return T(-1);
+    } else {
+      return T();
+    }
+  }
+
+  // Position in the buffer of the element with the given index
+  int position(int index) const {
+    return gapBuffer && index >= gapStart ? index + capacity - size : index;
+  }
+
+  const T& at(int index) const { return data[position(index)]; }
+
+  // Number of elements before the gap; the others follow it
+  int frontSize() const { return gapBuffer ? gapStart : size; }
 
-  int add(int element);
-  int insert(int index, int element);
-  int removeLast();
-  int removeAtIndex(int index);
-  int get(int index) const;
-  int change(int index, int element);
-  int search(int element) const;
+  const T* backData() const { return data + frontSize() + capacity - size; }
+
+  // Function to check an index of an existing element
+  bool checkIndex(int index) const;
+
+  // Function to find the first position whose element is not less than the
+  // given one in sorted mode
+  int lowerBound(const T& element) const;
+  int upperBound(const T& element) const;
+
+  void relocate(int newCapacity);
+  void moveGap(int index);
+  int insertValue(int index, T&& element);
 };
 
-// Function to add an element to the end of the array
-int Array::add(int element) {
-  if (size < getMaxLen()) {
-    data[size++] = element;
-    return size;
+// Function to switch the array into gap buffer mode
+template <typename T>
+void Array<T>::setGapBufferTrue() {
+  if (gapBuffer) return;
+  gapBuffer = true;
+  gapStart = size;
+}
+
+// Function to leave gap buffer mode, closing the gap at the end
+template <typename T>
+void Array<T>::setGapBufferFalse() {
+  if (!gapBuffer) return;
+  moveGap(size);
+  gapBuffer = false;
+}
+
+// Function to make room for at least newCapacity elements
+template <typename T>
+void Array<T>::reserve(int newCapacity) {
+  if (newCapacity > capacity) relocate(newCapacity);
+}
+
+// Function to release the capacity that is not used by elements
+template <typename T>
+void Array<T>::shrink_to_fit() {
+  if (size < capacity) relocate(size);
+}
+
+// Function to remove all the elements, keeping the capacity
+template <typename T>
+void Array<T>::clear() {
+  if constexpr (!is_trivially_destructible<T>::value) {
+    for (int i = 0; i < size; i++) data[position(i)].~T();
   }
-  if (getPrintErrors()) cerr << "Error: Array is full." << endl;
-  return -1;
+  size = 0;
+  gapStart = 0;
+}
+
+// Function to add an element to the end of the array
+template <typename T>
+int Array<T>::add(T element) {
+  int index = sorted ? upperBound(element) : size;
+  return insertValue(index, std::move(element));
 }
 
 // Function to insert an element at a specific index in the array
-int Array::insert(int index, int element) {
+template <typename T>
+int Array<T>::insert(int index, T element) {
   if (index < 0) {
     if (getPrintErrors()) cerr << "Error: Negative index." << endl;
     return -1;
@@ -56,29 +222,15 @@ int Array::insert(int index, int element) {
     return -1;
   }
 
-  if (size < getMaxLen()) {
-    for (int i = size; i > index; i--) {
-      data[i] = data[i - 1];
-    }
-    data[index] = element;
-    size++;
-    return size;
-  }
-  if (getPrintErrors()) cerr << "Error: Array is full." << endl;
-  return -1;
+  if (sorted) index = upperBound(element);  // The order wins over the index
+  return insertValue(index, std::move(element));
 }
 
-// Function to remove the last element in the array
-int Array::removeLast() {
-  if (size > 0) {
-    return data[--size];
-  }
-  if (getPrintErrors()) cerr << "Error: Array is empty." << endl;
-  return -1;
-}
-
-// Function to remove an element at a specific index in the array
-int Array::removeAtIndex(int index) {
+// Function to construct an element from args at a specific index in the
+// array
+template <typename T>
+template <typename... Args>
+int Array<T>::emplace(int index, Args&&... args) {
   if (index < 0) {
     if (getPrintErrors()) cerr << "Error: Negative index." << endl;
     return -1;
@@ -89,55 +241,275 @@ int Array::removeAtIndex(int index) {
     return -1;
   }
 
+  if (sorted) return insert(index, T(std::forward<Args>(args)...));
+  if (!gapBuffer && index == size && size < capacity) {
+    new (data + size) T(std::forward<Args>(args)...);
+    return ++size;
+  }
+  return insertValue(index, T(std::forward<Args>(args)...));
+}
+
+// Function to remove the last element in the array
+template <typename T>
+T Array<T>::removeLast() {
+  if (size > 0 && gapBuffer) return removeAtIndex(size - 1);
   if (size > 0) {
-    int element = data[index];
-    for (int i = index; i < size - 1; i++) {
-      data[i] = data[i + 1];
+    T element = std::move(data[--size]);
+    data[size].~T();
+    return element;
+  }
+  if (getPrintErrors()) cerr << "Error: Array is empty." << endl;
+  return errorValue();
+}
+
+// Function to remove an element at a specific index in the array
+template <typename T>
+T Array<T>::removeAtIndex(int index) {
+  if (size == 0 && index == 0) {
+    if (getPrintErrors()) cerr << "Error: Array is empty." << endl;
+    return errorValue();
+  }
+  if (!checkIndex(index)) return errorValue();
+
+  if (gapBuffer) {
+    // The gap is moved next to the element, which then joins it
+    int slot = index;
+    if (index < gapStart) {
+      moveGap(index + 1);
+      gapStart--;
+    } else {
+      moveGap(index);
+      slot = index + capacity - size;
     }
+    T element = std::move(data[slot]);
+    data[slot].~T();
     size--;
     return element;
   }
-  if (getPrintErrors()) cerr << "Error: Array is empty." << endl;
-  return -1;
+
+  T element = std::move(data[index]);
+  if constexpr (kTrivial) {
+    memmove(static_cast<void*>(data + index), data + index + 1,
+            sizeof(T) * (size - index - 1));
+  } else {
+    std::move(data + index + 1, data + size, data + index);
+    data[size - 1].~T();
+  }
+  size--;
+  return element;
 }
 
 // Function to get the value at a specific index in the array
-int Array::get(int index) const {
-  if (index < 0) {
-    if (getPrintErrors()) cerr << "Error: Negative index." << endl;
-    return -1;
+template <typename T>
+T Array<T>::get(int index) const {
+  if (!checkIndex(index)) return errorValue();
+  return at(index);
+}
+
+// Function to change the value at a specific index in the array
+template <typename T>
+T Array<T>::change(int index, T element) {
+  if (!checkIndex(index)) return errorValue();
+
+  data[position(index)] = element;
+  // A changed element that breaks the order leaves sorted mode
+  if (sorted && ((index > 0 && element < at(index - 1)) ||
+                 (index + 1 < size && at(index + 1) < element))) {
+    sorted = false;
   }
-  if (index > size) {
-    if (getPrintErrors()) cerr << "Error: Index is out of size." << endl;
-    return -1;
+  return element;
+}
+
+// Function to search for an element in the array and return the index of
+// its first occurrence
+template <typename T>
+int Array<T>::search(const T& element) const {
+  int index = size;
+  if (sorted) {
+    index = lowerBound(element);
+    if (index < size && !(at(index) == element)) index = size;
+  } else {
+    int front = frontSize();
+    if (front > 0) index = int(scanFind(data, front, element));
+    if (index >= front && size > front) {
+      index = front + int(scanFind(backData(), size - front, element));
+    }
   }
-  return data[index];
+  if (index < size) return index;
+  if (getPrintErrors()) cerr << "Error: Element not found." << endl;
+  return -1;
 }
 
-// Function to change the value at a specific index in the array
-int Array::change(int index, int element) {
+// Function to count the occurrences of an element in the array
+template <typename T>
+int Array<T>::count(const T& element) const {
+  if (sorted) return upperBound(element) - lowerBound(element);
+  int front = frontSize();
+  size_t found = 0;
+  if (front > 0) found += scanCount(data, front, element);
+  if (size > front) found += scanCount(backData(), size - front, element);
+  return int(found);
+}
+
+// Function to get the smallest element of the array
+template <typename T>
+T Array<T>::min() const {
+  if (size == 0) {
+    if (getPrintErrors()) cerr << "Error: Array is empty." << endl;
+    return errorValue();
+  }
+  if (sorted) return at(0);
+  int front = frontSize();
+  if (front == 0) return scanMin(backData(), size);
+  if (front == size) return scanMin(data, size);
+  T first = scanMin(data, front), second = scanMin(backData(), size - front);
+  return second < first ? second : first;
+}
+
+// Function to get the largest element of the array
+template <typename T>
+T Array<T>::max() const {
+  if (size == 0) {
+    if (getPrintErrors()) cerr << "Error: Array is empty." << endl;
+    return errorValue();
+  }
+  if (sorted) return at(size - 1);
+  int front = frontSize();
+  if (front == 0) return scanMax(backData(), size);
+  if (front == size) return scanMax(data, size);
+  T first = scanMax(data, front), second = scanMax(backData(), size - front);
+  return first < second ? second : first;
+}
+
+// Function to sort the elements in ascending order and switch the array into
+// sorted mode
+template <typename T>
+void Array<T>::sort() {
+  if (gapBuffer) moveGap(size);
+  std::sort(data, data + size);
+  sorted = true;
+}
+
+template <typename T>
+bool Array<T>::checkIndex(int index) const {
   if (index < 0) {
     if (getPrintErrors()) cerr << "Error: Negative index." << endl;
-    return -1;
+    return false;
   }
-  if (index > size) {
+  if (index >= size) {
     if (getPrintErrors()) cerr << "Error: Index is out of size." << endl;
-    return -1;
+    return false;
   }
+  return true;
+}
 
-  data[index] = element;
-  return element;
+// The binary searches halve the range without branching on the comparison,
+// so the loop has no mispredictions and the compiler emits conditional moves
+template <typename T>
+int Array<T>::lowerBound(const T& element) const {
+  if (size == 0) return 0;
+  int base = 0, length = size;
+  while (length > 1) {
+    int half = length / 2;
+    base += at(base + half - 1) < element ? half : 0;
+    length -= half;
+  }
+  return base + (at(base) < element);
 }
 
-// Function to search for an element in the array and return its index
-int Array::search(int element) const {
-  for (int i = 0; i < size; i++) {
-    if (data[i] == element) {
-      return i;
+template <typename T>
+int Array<T>::upperBound(const T& element) const {
+  if (size == 0) return 0;
+  int base = 0, length = size;
+  while (length > 1) {
+    int half = length / 2;
+    base += element < at(base + half - 1) ? 0 : half;
+    length -= half;
+  }
+  return base + !(element < at(base));
+}
+
+// Function to move the elements to a new buffer of the given capacity. The
+// elements after the gap stay at the end of the buffer
+template <typename T>
+void Array<T>::relocate(int newCapacity) {
+  T* newData =
+      newCapacity > 0 ? allocator<T>().allocate(newCapacity) : nullptr;
+  int front = frontSize();
+  T* source = data;
+  T* target = newData;
+  for (int length : {front, size - front}) {
+    if constexpr (kTrivial) {
+      if (length > 0) {
+        memcpy(static_cast<void*>(target), source, sizeof(T) * length);
+      }
+    } else {
+      for (int i = 0; i < length; i++) {
+        new (target + i) T(std::move_if_noexcept(source[i]));
+        source[i].~T();
+      }
     }
+    source = data + front + capacity - size;
+    target = newData + front + newCapacity - size;
   }
-  if (getPrintErrors()) cerr << "Error: Element not found." << endl;
-  return -1;
+  allocator<T>().deallocate(data, capacity);
+  data = newData;
+  capacity = newCapacity;
+}
+
+// Function to move the gap to the given index in gap buffer mode. Only the
+// elements between the old and the new position of the gap move
+template <typename T>
+void Array<T>::moveGap(int index) {
+  int gap = capacity - size;
+  if (gap > 0 && index < gapStart) {
+    if constexpr (kTrivial) {
+      memmove(static_cast<void*>(data + index + gap), data + index,
+              sizeof(T) * (gapStart - index));
+    } else {
+      for (int i = gapStart - 1; i >= index; i--) {
+        new (data + i + gap) T(std::move(data[i]));
+        data[i].~T();
+      }
+    }
+  } else if (gap > 0 && index > gapStart) {
+    if constexpr (kTrivial) {
+      memmove(static_cast<void*>(data + gapStart), data + gapStart + gap,
+              sizeof(T) * (index - gapStart));
+    } else {
+      for (int i = gapStart; i < index; i++) {
+        new (data + i) T(std::move(data[i + gap]));
+        data[i + gap].~T();
+      }
+    }
+  }
+  gapStart = index;
+}
+
+// Function to insert an element at a checked index, growing the array if it
+// is full
+template <typename T>
+int Array<T>::insertValue(int index, T&& element) {
+  if (size == capacity) relocate(capacity == 0 ? 4 : capacity * 2);
+
+  if (gapBuffer) {
+    moveGap(index);
+    new (data + gapStart++) T(std::move(element));
+    return ++size;
+  }
+
+  if constexpr (kTrivial) {
+    memmove(static_cast<void*>(data + index + 1), data + index,
+            sizeof(T) * (size - index));
+    new (data + index) T(std::move(element));
+  } else if (index == size) {
+    new (data + size) T(std::move(element));
+  } else {
+    new (data + size) T(std::move(data[size - 1]));
+    std::move_backward(data + index, data + size - 1, data + size);
+    data[index] = std::move(element);
+  }
+  return ++size;
 }
 
-#endif
\ No newline at end of file
+#endif
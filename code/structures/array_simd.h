@@ -0,0 +1,244 @@
+#ifndef ARRAY_SIMD_H
+#define ARRAY_SIMD_H
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ARRAY_SIMD_X86 1
+#endif
+
+using namespace std;
+
+// Scan kernels of Array. The generic versions are plain loops; int has SSE2
+// versions and AVX2 versions that are selected at run time. The kernels
+// return count for a value that is not found, and count must be positive for
+// the minimum and the maximum
+
+template <typename T>
+size_t scanFind(const T* data, size_t count, const T& value) {
+  for (size_t i = 0; i < count; i++) {
+    if (data[i] == value) return i;
+  }
+  return count;
+}
+
+template <typename T>
+size_t scanCount(const T* data, size_t count, const T& value) {
+  size_t found = 0;
+  for (size_t i = 0; i < count; i++) found += data[i] == value;
+  return found;
+}
+
+template <typename T>
+T scanMin(const T* data, size_t count) {
+  T result = data[0];
+  for (size_t i = 1; i < count; i++) {
+    if (data[i] < result) result = data[i];
+  }
+  return result;
+}
+
+template <typename T>
+T scanMax(const T* data, size_t count) {
+  T result = data[0];
+  for (size_t i = 1; i < count; i++) {
+    if (result < data[i]) result = data[i];
+  }
+  return result;
+}
+
+#ifdef ARRAY_SIMD_X86
+
+namespace simd {
+
+// Checks once whether the processor supports AVX2
+inline bool hasAvx2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+
+// Returns the sum, minimum or maximum of the lanes of a register
+inline size_t laneSum(__m128i v) {
+  int lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), v);
+  return size_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+}
+
+inline int laneMin(__m128i v) {
+  int lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), v);
+  int result = lanes[0];
+  for (int lane : lanes) result = lane < result ? lane : result;
+  return result;
+}
+
+inline int laneMax(__m128i v) {
+  int lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), v);
+  int result = lanes[0];
+  for (int lane : lanes) result = result < lane ? lane : result;
+  return result;
+}
+
+// Scalar loops for the elements that do not fill a register
+inline size_t findTail(const int* data, size_t i, size_t count, int value) {
+  for (; i < count; i++) {
+    if (data[i] == value) return i;
+  }
+  return count;
+}
+
+inline size_t countTail(const int* data, size_t i, size_t count, int value) {
+  size_t found = 0;
+  for (; i < count; i++) found += data[i] == value;
+  return found;
+}
+
+// SSE2 has no 32-bit minimum and maximum, so they are built from a compare
+inline __m128i minEpi32Sse2(__m128i a, __m128i b) {
+  __m128i greater = _mm_cmpgt_epi32(a, b);
+  return _mm_or_si128(_mm_and_si128(greater, b),
+                      _mm_andnot_si128(greater, a));
+}
+
+inline __m128i maxEpi32Sse2(__m128i a, __m128i b) {
+  __m128i greater = _mm_cmpgt_epi32(a, b);
+  return _mm_or_si128(_mm_and_si128(greater, a),
+                      _mm_andnot_si128(greater, b));
+}
+
+inline __m128i load(const int* data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+__attribute__((target("avx2"))) inline __m256i load256(const int* data) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+inline size_t findSse2(const int* data, size_t count, int value) {
+  __m128i needle = _mm_set1_epi32(value);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i equal = _mm_cmpeq_epi32(load(data + i), needle);
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(equal));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+  return findTail(data, i, count, value);
+}
+
+__attribute__((target("avx2"))) inline size_t findAvx2(const int* data,
+                                                       size_t count,
+                                                       int value) {
+  __m256i needle = _mm256_set1_epi32(value);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i equal = _mm256_cmpeq_epi32(load256(data + i), needle);
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+  return findTail(data, i, count, value);
+}
+
+// A lane of a compare is -1 where the values are equal, so subtracting it
+// counts the matches. Lanes overflow only beyond 2^31 elements per lane
+inline size_t countSse2(const int* data, size_t count, int value) {
+  __m128i needle = _mm_set1_epi32(value);
+  __m128i acc = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(load(data + i), needle));
+  }
+  return laneSum(acc) + countTail(data, i, count, value);
+}
+
+__attribute__((target("avx2"))) inline size_t countAvx2(const int* data,
+                                                        size_t count,
+                                                        int value) {
+  __m256i needle = _mm256_set1_epi32(value);
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    acc = _mm256_sub_epi32(acc,
+                           _mm256_cmpeq_epi32(load256(data + i), needle));
+  }
+  __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                               _mm256_extracti128_si256(acc, 1));
+  return laneSum(half) + countTail(data, i, count, value);
+}
+
+inline int minSse2(const int* data, size_t count) {
+  __m128i acc = _mm_set1_epi32(data[0]);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) acc = minEpi32Sse2(acc, load(data + i));
+  int result = laneMin(acc);
+  for (; i < count; i++) result = data[i] < result ? data[i] : result;
+  return result;
+}
+
+__attribute__((target("avx2"))) inline int minAvx2(const int* data,
+                                                   size_t count) {
+  __m256i acc = _mm256_set1_epi32(data[0]);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    acc = _mm256_min_epi32(acc, load256(data + i));
+  }
+  int result = laneMin(_mm_min_epi32(_mm256_castsi256_si128(acc),
+                                     _mm256_extracti128_si256(acc, 1)));
+  for (; i < count; i++) result = data[i] < result ? data[i] : result;
+  return result;
+}
+
+inline int maxSse2(const int* data, size_t count) {
+  __m128i acc = _mm_set1_epi32(data[0]);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) acc = maxEpi32Sse2(acc, load(data + i));
+  int result = laneMax(acc);
+  for (; i < count; i++) result = result < data[i] ? data[i] : result;
+  return result;
+}
+
+__attribute__((target("avx2"))) inline int maxAvx2(const int* data,
+                                                   size_t count) {
+  __m256i acc = _mm256_set1_epi32(data[0]);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    acc = _mm256_max_epi32(acc, load256(data + i));
+  }
+  int result = laneMax(_mm_max_epi32(_mm256_castsi256_si128(acc),
+                                     _mm256_extracti128_si256(acc, 1)));
+  for (; i < count; i++) result = result < data[i] ? data[i] : result;
+  return result;
+}
+
+}  // namespace simd
+
+// Specializations that dispatch to the vectorized kernels
+template <>
+inline size_t scanFind<int>(const int* data, size_t count, const int& value) {
+  return simd::hasAvx2() ? simd::findAvx2(data, count, value)
+                         : simd::findSse2(data, count, value);
+}
+
+template <>
+inline size_t scanCount<int>(const int* data, size_t count,
+                             const int& value) {
+  return simd::hasAvx2() ? simd::countAvx2(data, count, value)
+                         : simd::countSse2(data, count, value);
+}
+
+template <>
+inline int scanMin<int>(const int* data, size_t count) {
+  return simd::hasAvx2() ? simd::minAvx2(data, count)
+                         : simd::minSse2(data, count);
+}
+
+template <>
+inline int scanMax<int>(const int* data, size_t count) {
+  return simd::hasAvx2() ? simd::maxAvx2(data, count)
+                         : simd::maxSse2(data, count);
+}
+
+#endif
+
+#endif
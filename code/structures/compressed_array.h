@@ -0,0 +1,268 @@
+#ifndef COMPRESSED_ARRAY_H
+#define COMPRESSED_ARRAY_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "array_simd.h"
+using namespace std;
+
+// CompressedArray is an append-only array of ints that stores full blocks of
+// kBlockSize values bit-packed. A block is stored either as offsets from its
+// minimum (frame of reference) or, if its values do not decrease and that
+// is smaller, as differences between neighbours, using as many bits per
+// value as its largest offset or difference needs. A delta block also keeps
+// the offset from the minimum of every kCheckpointStride-th value, so get()
+// adds at most kCheckpointStride - 1 differences. New values go to an
+// uncompressed tail block that is packed when it is full
+class CompressedArray {
+ public:
+  static const int kBlockSize = 128;
+  static const int kCheckpointStride = 16;
+
+  CompressedArray() = default;
+
+  void setPrintErrorsFalse() { printErrors = 0; }
+
+  void setPrintErrorsTrue() { printErrors = 1; }
+
+  int getPrintErrors() const { return printErrors; }
+
+  int getSize() const { return int(blocks.size()) * kBlockSize + tailSize; }
+
+  // Bytes used by the array, including its unused capacity
+  size_t getMemoryUsage() const {
+    return sizeof(*this) + bytes.capacity() +
+           blocks.capacity() * sizeof(Block);
+  }
+
+  void shrink_to_fit() {
+    bytes.shrink_to_fit();
+    blocks.shrink_to_fit();
+  }
+
+  int add(int element);
+  int get(int index) const;
+  int search(int element) const;
+
+ private:
+  struct Block {
+    int32_t min;
+    int32_t max;
+    uint32_t offset;         // Offset of the packed values in bytes
+    uint8_t bits;            // Bits per packed value
+    bool delta;              // Values are stored as differences
+    uint8_t checkpointBits;  // Bits per checkpoint of a delta block
+  };
+
+  // Checkpoints of a delta block, stored after its differences. Checkpoint
+  // k is the offset of value k * kCheckpointStride from the minimum
+  static const int kCheckpoints = kBlockSize / kCheckpointStride - 1;
+
+  // Bytes read past the packed values of the last block, so every value can
+  // be loaded with one unaligned 64-bit load
+  static const size_t kPadding = 8;
+
+  vector<uint8_t> bytes;
+  vector<Block> blocks;
+  int tail[kBlockSize];
+  int tailSize = 0;
+  int printErrors = 1;  // A flag to control error message printing
+
+  static uint64_t load(const uint8_t* from) {
+    uint64_t word;
+    memcpy(&word, from, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+  }
+
+  static void store(uint8_t* to, uint64_t word) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    memcpy(to, &word, sizeof(word));
+  }
+
+  static int bitWidth(uint32_t value) {
+    return value == 0 ? 0 : 32 - __builtin_clz(value);
+  }
+
+  // Function to read width bits at a bit position of a block
+  uint32_t read(const Block& block, size_t position, int width) const {
+    uint64_t word = load(bytes.data() + block.offset + position / 8);
+    uint64_t mask = (uint64_t(1) << width) - 1;
+    return uint32_t((word >> (position % 8)) & mask);
+  }
+
+  // Function to extract the packed value with the given index of a block
+  uint32_t extract(const Block& block, int index) const {
+    return read(block, size_t(index) * block.bits, block.bits);
+  }
+
+  // Bit position of checkpoint k, from 1 to kCheckpoints, of a delta block
+  static size_t checkpointPosition(const Block& block, int k) {
+    return size_t(kBlockSize) * block.bits +
+           size_t(k - 1) * block.checkpointBits;
+  }
+
+  void seal();
+  void unpack(const Block& block, uint32_t* codes) const;
+};
+
+// Function to add an element to the end of the array
+inline int CompressedArray::add(int element) {
+  tail[tailSize++] = element;
+  if (tailSize == kBlockSize) seal();
+  return getSize();
+}
+
+// Function to get the value at a specific index in the array
+inline int CompressedArray::get(int index) const {
+  if (index < 0) {
+    if (getPrintErrors()) cerr << "Error: Negative index." << endl;
+    return -1;
+  }
+  if (index >= getSize()) {
+    if (getPrintErrors()) cerr << "Error: Index is out of size." << endl;
+    return -1;
+  }
+
+  const int sealed = int(blocks.size()) * kBlockSize;
+  if (index >= sealed) return tail[index - sealed];
+  const Block& block = blocks[index / kBlockSize];
+  int slot = index % kBlockSize;
+  if (!block.delta) return int(uint32_t(block.min) + extract(block, slot));
+
+  // Add the differences after the last checkpoint at or before the slot
+  int checkpoint = slot / kCheckpointStride;
+  uint32_t value = uint32_t(block.min);
+  if (checkpoint > 0) {
+    value += read(block, checkpointPosition(block, checkpoint),
+                  block.checkpointBits);
+  }
+  for (int i = checkpoint * kCheckpointStride + 1; i <= slot; i++) {
+    value += extract(block, i);
+  }
+  return int(value);
+}
+
+// Function to search for an element in the array and return the index of
+// its first occurrence. Blocks whose range does not hold the element are
+// skipped, the others are unpacked and scanned without adding their minimum
+inline int CompressedArray::search(int element) const {
+  int codes[kBlockSize];
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const Block& block = blocks[i];
+    if (element < block.min || element > block.max) continue;
+    unpack(block, reinterpret_cast<uint32_t*>(codes));
+    if (block.delta) {
+      uint32_t value = uint32_t(block.min);
+      for (int& code : codes) code = int(value += uint32_t(code));
+    }
+    int target = block.delta ? element : int(uint32_t(element) - block.min);
+    size_t found = scanFind(codes, kBlockSize, target);
+    if (found < size_t(kBlockSize)) return int(i) * kBlockSize + int(found);
+  }
+
+  size_t found = tailSize > 0 ? scanFind(tail, tailSize, element) : 0;
+  if (tailSize > 0 && found < size_t(tailSize)) {
+    return int(blocks.size()) * kBlockSize + int(found);
+  }
+  if (getPrintErrors()) cerr << "Error: Element not found." << endl;
+  return -1;
+}
+
+// Function to pack the full tail block
+inline void CompressedArray::seal() {
+  Block block;
+  block.min = block.max = tail[0];
+  bool ascending = true;
+  uint32_t maxDelta = 0;
+  for (int i = 1; i < kBlockSize; i++) {
+    if (tail[i] < block.min) block.min = tail[i];
+    if (tail[i] > block.max) block.max = tail[i];
+    if (tail[i] < tail[i - 1]) ascending = false;
+    uint32_t delta = uint32_t(tail[i]) - uint32_t(tail[i - 1]);
+    if (delta > maxDelta) maxDelta = delta;
+  }
+  int rangeBits = bitWidth(uint32_t(block.max) - uint32_t(block.min));
+  int deltaBits = bitWidth(maxDelta);
+  // The checkpoints of a delta block are offsets, so they need rangeBits
+  int deltaSize = kBlockSize * deltaBits + kCheckpoints * rangeBits;
+  block.delta = ascending && deltaSize < kBlockSize * rangeBits;
+  block.bits = uint8_t(block.delta ? deltaBits : rangeBits);
+  block.checkpointBits = uint8_t(block.delta ? rangeBits : 0);
+
+  // The padding of the previous block becomes the start of this one
+  size_t start = bytes.empty() ? 0 : bytes.size() - kPadding;
+  size_t length =
+      (size_t(kBlockSize) * block.bits + kCheckpoints * block.checkpointBits +
+       7) / 8;
+  bytes.resize(start + length + kPadding, 0);
+  block.offset = uint32_t(start);
+  auto write = [&](size_t position, uint32_t code) {
+    uint8_t* at = bytes.data() + start + position / 8;
+    store(at, load(at) | (uint64_t(code) << (position % 8)));
+  };
+  for (int i = 0; i < kBlockSize; i++) {
+    uint32_t code = uint32_t(tail[i]) - uint32_t(block.min);
+    if (block.delta) code = i == 0 ? 0 : uint32_t(tail[i]) - tail[i - 1];
+    write(size_t(i) * block.bits, code);
+  }
+  for (int k = 1; block.delta && k <= kCheckpoints; k++) {
+    write(checkpointPosition(block, k),
+          uint32_t(tail[k * kCheckpointStride]) - uint32_t(block.min));
+  }
+  blocks.push_back(block);
+  tailSize = 0;
+}
+
+#ifdef ARRAY_SIMD_X86
+
+namespace simd {
+
+// Unpacks four values per step: the 64-bit words that hold them are
+// gathered, shifted by their bit offsets and masked
+__attribute__((target("avx2"))) inline void unpackAvx2(const uint8_t* bytes,
+                                                       int bits,
+                                                       uint32_t* codes,
+                                                       int count) {
+  const __m256i mask = _mm256_set1_epi64x((int64_t(1) << bits) - 1);
+  const __m256i lanes = _mm256_set_epi64x(3 * bits, 2 * bits, bits, 0);
+  const __m256i permutation = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+  for (int i = 0; i < count; i += 4) {
+    __m256i positions =
+        _mm256_add_epi64(_mm256_set1_epi64x(int64_t(i) * bits), lanes);
+    __m256i words = _mm256_i64gather_epi64(
+        reinterpret_cast<const long long*>(bytes),
+        _mm256_srli_epi64(positions, 3), 1);
+    __m256i shifts = _mm256_and_si256(positions, _mm256_set1_epi64x(7));
+    __m256i values = _mm256_and_si256(_mm256_srlv_epi64(words, shifts), mask);
+    __m256i packed = _mm256_permutevar8x32_epi32(values, permutation);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + i),
+                     _mm256_castsi256_si128(packed));
+  }
+}
+
+}  // namespace simd
+
+#endif
+
+// Function to unpack all the values of a block
+inline void CompressedArray::unpack(const Block& block,
+                                    uint32_t* codes) const {
+#ifdef ARRAY_SIMD_X86
+  if (simd::hasAvx2()) {
+    simd::unpackAvx2(bytes.data() + block.offset, block.bits, codes,
+                     kBlockSize);
+    return;
+  }
+#endif
+  for (int i = 0; i < kBlockSize; i++) codes[i] = extract(block, i);
+}
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef CONCURRENT_HASH_H
+#define CONCURRENT_HASH_H
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "epoch.h"
+#include "wyhash.h"
+using namespace std;
+
+// Node of ConcurrentHashTable. Nodes are never changed after they are
+// linked in: setting a key again links in a new node in place of the old one
+class ConcurrentHashNode {
+ public:
+  const string key;
+  const string element;
+  atomic<ConcurrentHashNode*> next;
+
+  ConcurrentHashNode(string k, string val, ConcurrentHashNode* next)
+      : key(std::move(k)), element(std::move(val)), next(next) {}
+};
+
+// ConcurrentHashTable is a chained hash table that can be used by many
+// threads at once. get() and find() take no lock: they pin the epoch and
+// follow the chain, and writers publish nodes with release stores. set() and
+// del() lock one of kStripes mutexes, chosen by the bucket, so writers of
+// different stripes do not wait for each other. Unlinked nodes are retired
+// to the list of their stripe and freed by later writes of the stripe once
+// no reader can reach them (epoch.h).
+//
+// The table doubles when it holds twice as many keys as buckets. Growing
+// locks every stripe and copies the nodes into a new bucket array; readers
+// keep using the old one until it is published, so they never wait
+class ConcurrentHashTable {
+ public:
+  static constexpr int kStripes = 128;
+
+  ConcurrentHashTable(int capacity = 100, uint64_t seed = 0) : seed(seed) {
+    table.store(makeTable(capacity));
+  }
+
+  ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+  ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+
+  // The destructor must not run while other threads use the table
+  ~ConcurrentHashTable();
+
+  void setPrintErrorsFalse() { printErrors = 0; }
+
+  void setPrintErrorsTrue() { printErrors = 1; }
+
+  int getPrintErrors() const { return printErrors; }
+
+  int getCapacity() const { return table.load()->size; }
+
+  int getSize() const { return int(count.load()); }
+
+  const string set(string key, string value);
+  const string del(string_view key);
+  const string get(string_view key) const;
+
+  // Function to copy the value of a key into value. Returns false if the
+  // key is absent. No memory is allocated if value has enough capacity
+  bool find(string_view key, string& value) const;
+
+ private:
+  // Writes of a stripe between two attempts to free its retired objects
+  static constexpr unsigned kReclaimInterval = 64;
+
+  struct Table {
+    int size;
+    atomic<ConcurrentHashNode*>* buckets;
+  };
+
+  struct Retired {
+    void* object;
+    void (*destroy)(void*);
+    uint64_t epoch;
+  };
+
+  struct alignas(64) Stripe {
+    mutex lock;
+    vector<Retired> retired;  // In the order of their epochs
+    unsigned writes = 0;
+  };
+
+  atomic<Table*> table;
+  Stripe stripes[kStripes];
+  alignas(64) atomic<long> count{0};
+  uint64_t seed;
+  int printErrors = 1;  // A flag to control error message printing
+
+  static Table* makeTable(int size) {
+    return new Table{size, new atomic<ConcurrentHashNode*>[size]()};
+  }
+
+  static void destroyNode(void* node) {
+    delete static_cast<ConcurrentHashNode*>(node);
+  }
+
+  static void destroyTable(void* object) {
+    Table* old = static_cast<Table*>(object);
+    delete[] old->buckets;
+    delete old;
+  }
+
+  static int bucketOf(uint64_t hash, int buckets) {
+    return int((__uint128_t(hash) * uint64_t(buckets)) >> 64);
+  }
+
+  // Function to lock the stripe of a hash in the current table. The table
+  // cannot be replaced while the stripe is locked
+  Table* lockStripe(uint64_t hash, Stripe*& stripe);
+
+  void retire(Stripe& stripe, void* object, void (*destroy)(void*)) {
+    stripe.retired.push_back({object, destroy, Epoch::current()});
+  }
+
+  void afterWrite(Stripe& stripe);
+  void reclaim(Stripe& stripe);
+  void grow(Table* full);
+};
+
+inline ConcurrentHashTable::~ConcurrentHashTable() {
+  for (Stripe& stripe : stripes) {
+    for (Retired& retired : stripe.retired) retired.destroy(retired.object);
+  }
+  Table* current = table.load();
+  for (int i = 0; i < current->size; i++) {
+    ConcurrentHashNode* node = current->buckets[i].load();
+    while (node != nullptr) {
+      ConcurrentHashNode* next = node->next.load();
+      delete node;
+      node = next;
+    }
+  }
+  destroyTable(current);
+}
+
+// Function to insert or update a key-value pair in the hash table
+inline const string ConcurrentHashTable::set(string key, string value) {
+  uint64_t hash = wyhash(key.data(), key.size(), seed);
+  Stripe* stripe;
+  Table* current = lockStripe(hash, stripe);
+  unique_lock<mutex> lock(stripe->lock, adopt_lock);
+
+  atomic<ConcurrentHashNode*>& head =
+      current->buckets[bucketOf(hash, current->size)];
+  atomic<ConcurrentHashNode*>* link = &head;
+  for (ConcurrentHashNode* node = link->load(memory_order_relaxed);
+       node != nullptr; node = link->load(memory_order_relaxed)) {
+    if (node->key == key) {
+      ConcurrentHashNode* replacement = new ConcurrentHashNode(
+          std::move(key), std::move(value),
+          node->next.load(memory_order_relaxed));
+      link->store(replacement, memory_order_release);
+      retire(*stripe, node, destroyNode);
+      afterWrite(*stripe);
+      return replacement->element;
+    }
+    link = &node->next;
+  }
+
+  ConcurrentHashNode* node = new ConcurrentHashNode(
+      std::move(key), std::move(value), head.load(memory_order_relaxed));
+  head.store(node, memory_order_release);
+  string element = node->element;
+  long buckets = current->size;
+  afterWrite(*stripe);
+  lock.unlock();
+
+  // The table may be replaced once the stripe is unlocked, so grow() only
+  // compares the pointer to the current table
+  if (count.fetch_add(1, memory_order_relaxed) + 1 > 2 * buckets) {
+    grow(current);
+  }
+  return element;
+}
+
+// Function to delete a key-value pair from the hash table
+inline const string ConcurrentHashTable::del(string_view key) {
+  uint64_t hash = wyhash(key.data(), key.size(), seed);
+  Stripe* stripe;
+  Table* current = lockStripe(hash, stripe);
+  unique_lock<mutex> lock(stripe->lock, adopt_lock);
+
+  atomic<ConcurrentHashNode*>* link =
+      &current->buckets[bucketOf(hash, current->size)];
+  for (ConcurrentHashNode* node = link->load(memory_order_relaxed);
+       node != nullptr; node = link->load(memory_order_relaxed)) {
+    if (node->key == key) {
+      link->store(node->next.load(memory_order_relaxed),
+                  memory_order_release);
+      string element = node->element;
+      retire(*stripe, node, destroyNode);
+      afterWrite(*stripe);
+      count.fetch_sub(1, memory_order_relaxed);
+      return element;
+    }
+    link = &node->next;
+  }
+  if (getPrintErrors()) cerr << "Error: key is empty.";
+  return "";
+}
+
+// Retrieves an element from the hash table based on the provided key
+inline const string ConcurrentHashTable::get(string_view key) const {
+  string element;
+  if (find(key, element)) return element;
+  if (getPrintErrors()) cerr << "Error: key is empty";
+  return "";
+}
+
+inline bool ConcurrentHashTable::find(string_view key, string& value) const {
+  uint64_t hash = wyhash(key.data(), key.size(), seed);
+  EpochGuard guard;
+  Table* current = table.load(memory_order_acquire);
+  for (ConcurrentHashNode* node =
+           current->buckets[bucketOf(hash, current->size)].load(
+               memory_order_acquire);
+       node != nullptr; node = node->next.load(memory_order_acquire)) {
+    if (node->key == key) {
+      value = node->element;
+      return true;
+    }
+  }
+  return false;
+}
+
+inline ConcurrentHashTable::Table* ConcurrentHashTable::lockStripe(
+    uint64_t hash, Stripe*& stripe) {
+  for (;;) {
+    Table* current = table.load(memory_order_acquire);
+    stripe = &stripes[bucketOf(hash, current->size) % kStripes];
+    stripe->lock.lock();
+    if (table.load(memory_order_acquire) == current) return current;
+    stripe->lock.unlock();
+  }
+}
+
+inline void ConcurrentHashTable::afterWrite(Stripe& stripe) {
+  if (!stripe.retired.empty() && ++stripe.writes % kReclaimInterval == 0) {
+    reclaim(stripe);
+  }
+}
+
+// Function to free the retired objects of a locked stripe that were retired
+// at least two epochs ago
+inline void ConcurrentHashTable::reclaim(Stripe& stripe) {
+  uint64_t epoch = Epoch::tryAdvance();
+  size_t freed = 0;
+  while (freed < stripe.retired.size() &&
+         stripe.retired[freed].epoch + 2 <= epoch) {
+    stripe.retired[freed].destroy(stripe.retired[freed].object);
+    freed++;
+  }
+  stripe.retired.erase(stripe.retired.begin(),
+                       stripe.retired.begin() + freed);
+}
+
+// Function to replace a full table with one of twice as many buckets. The
+// old nodes are copied, since readers may still be following their links,
+// and are retired only after the new table is published
+inline void ConcurrentHashTable::grow(Table* full) {
+  for (Stripe& stripe : stripes) stripe.lock.lock();
+  if (table.load(memory_order_relaxed) == full &&
+      count.load(memory_order_relaxed) > 2L * full->size) {
+    Table* next = makeTable(full->size * 2);
+    for (int i = 0; i < full->size; i++) {
+      for (ConcurrentHashNode* node = full->buckets[i].load();
+           node != nullptr; node = node->next.load()) {
+        uint64_t hash = wyhash(node->key.data(), node->key.size(), seed);
+        atomic<ConcurrentHashNode*>& head =
+            next->buckets[bucketOf(hash, next->size)];
+        head.store(new ConcurrentHashNode(node->key, node->element,
+                                          head.load(memory_order_relaxed)),
+                   memory_order_relaxed);
+      }
+    }
+    table.store(next, memory_order_release);
+
+    for (int i = 0; i < full->size; i++) {
+      for (ConcurrentHashNode* node = full->buckets[i].load();
+           node != nullptr; node = node->next.load()) {
+        retire(stripes[i % kStripes], node, destroyNode);
+      }
+    }
+    retire(stripes[0], full, destroyTable);
+  }
+  for (Stripe& stripe : stripes) stripe.lock.unlock();
+}
+
+#endif
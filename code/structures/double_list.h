@@ -1,30 +1,123 @@
 #ifndef DOUBLE_LIST_H
 #define DOUBLE_LIST_H
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "node_pool.h"
 using namespace std;
 
+class DoubleNode;
+
+// Link of the skip list index: the next node on a level and the number of
+// list positions it is ahead
+struct SkipLink {
+  DoubleNode* next;
+  int span;
+};
+
 // Node class to represent individual elements in the doubly linked list
 class DoubleNode {
  public:
   string element;
   DoubleNode* prev;
   DoubleNode* next;
+  SkipLink* links = nullptr;  // Links of the levels of the skip list index
+  int height = 0;             // Number of index levels the node is on
   DoubleNode(const string& data)
       : element(data), prev(nullptr), next(nullptr) {}
+  DoubleNode(const DoubleNode&) = delete;
+  DoubleNode& operator=(const DoubleNode&) = delete;
+};
+
+// SkipLinkPool allocates the links of the skip list index. A height is
+// rounded up to 1, 2, 4, 8 or 16 links and every size has its own NodePool,
+// so adding a node to the index does not call operator new
+class SkipLinkPool {
+ public:
+  static constexpr int kMaxLinks = 16;
+
+  SkipLink* make(int height);
+  void destroy(SkipLink* links, int height);
+
+ private:
+  template <int Links>
+  struct Tower {
+    SkipLink links[Links];
+  };
+
+  NodePool<Tower<1>> ones;
+  NodePool<Tower<2>> twos;
+  NodePool<Tower<4>> fours;
+  NodePool<Tower<8>> eights;
+  NodePool<Tower<kMaxLinks>> sixteens;
 };
 
-// DoubleLinkedList class to encapsulate the double linked list functionality
+// Function to allocate zeroed links for a height of 1 to kMaxLinks
+SkipLink* SkipLinkPool::make(int height) {
+  if (height <= 1) return ones.make()->links;
+  if (height <= 2) return twos.make()->links;
+  if (height <= 4) return fours.make()->links;
+  if (height <= 8) return eights.make()->links;
+  return sixteens.make()->links;
+}
+
+void SkipLinkPool::destroy(SkipLink* links, int height) {
+  if (height <= 1) {
+    ones.destroy(reinterpret_cast<Tower<1>*>(links));
+  } else if (height <= 2) {
+    twos.destroy(reinterpret_cast<Tower<2>*>(links));
+  } else if (height <= 4) {
+    fours.destroy(reinterpret_cast<Tower<4>*>(links));
+  } else if (height <= 8) {
+    eights.destroy(reinterpret_cast<Tower<8>*>(links));
+  } else {
+    sixteens.destroy(reinterpret_cast<Tower<kMaxLinks>*>(links));
+  }
+}
+
+// DoubleLinkedList class to encapsulate the double linked list functionality.
+// The list tracks its size, so an index is reached from the closer end. With
+// setIndexTrue() it also keeps an indexable skip list over the nodes, which
+// makes access, insertion and removal by index O(log n) on average. With
+// setValueIndexTrue() it keeps a hash index from values to their nodes, so
+// removeByValue() and search() find a value in O(1) expected time; the
+// nodes of a value are kept in list order, so the first one is found. The
+// position of the node, which search() returns and the skip list index needs
+// on removal, is counted through the skip list index in O(log n) if it is
+// on, and by a walk to the closer end otherwise
 class DoubleLinkedList {
  private:
+  static constexpr int kMaxLevels = SkipLinkPool::kMaxLinks;
+
   DoubleNode* head;
   DoubleNode* tail;
+  int size = 0;
   int printErrors = 1;  // A flag to control error message printing
+  SkipLink* headLinks = nullptr;     // Index links of the position before head
+  int levels = 0;                    // Number of index levels in use
+  SkipLinkPool* linkPool = nullptr;  // Allocates the links of the index
+  uint64_t random = 0x9E3779B97F4A7C15ull;
+  // Nodes of every value in list order. A key views the element of one of
+  // its nodes
+  unordered_map<string_view, vector<DoubleNode*>> values;
+  bool valueIndex = false;
+  NodePool<DoubleNode> ownNodes;
+  NodePool<DoubleNode>* nodes = &ownNodes;
 
  public:
   // Constructor to initialize an empty double linked list
   DoubleLinkedList() : head(nullptr), tail(nullptr) {}
 
+  // Constructor to allocate the nodes from a shared pool
+  explicit DoubleLinkedList(NodePool<DoubleNode>& pool) : DoubleLinkedList() {
+    nodes = &pool;
+  }
+
   // Destructor to free the memory allocated for the entire double linked list
   ~DoubleLinkedList() {
     while (head != nullptr) {
@@ -33,8 +126,9 @@ class DoubleLinkedList {
 
       // Delete the node, which will invoke the DoubleNode destructor and free
       // the string element
-      delete temp;
+      nodes->destroy(temp);
     }
+    delete linkPool;
   }
 
   void setPrintErrorsFalse() { printErrors = 0; }
@@ -43,6 +137,23 @@ class DoubleLinkedList {
 
   int getPrintErrors() { return printErrors; }
 
+  int getSize() const { return size; }
+
+  void setIndexTrue();
+
+  void setIndexFalse();
+
+  bool getIndex() const { return headLinks != nullptr; }
+
+  void setValueIndexTrue();
+
+  void setValueIndexFalse();
+
+  bool getValueIndex() const { return valueIndex; }
+
+  // Bytes used by the value index
+  size_t getValueIndexMemoryUsage() const;
+
   void addToBeginning(const string& data);
   void addToEnd(const string& data);
   void removeByValue(const string& value, string& removedElement);
@@ -50,57 +161,144 @@ class DoubleLinkedList {
   int insertAtIndex(const string& data, int index);
   void removeFromBeginning(string& removedElement);
   void removeAtIndex(int index, string& removedElement);
+  int getAtIndex(int index, string& element);
   int search(const string& value);
+
+ private:
+  // Function to find the node at an existing index
+  DoubleNode* nodeAt(int index);
+
+  // Function to find the index of a node. With the skip list index the
+  // positions after it are counted along the index; otherwise it walks from
+  // the node towards both ends at once, so the walk stops at the closer end
+  int positionOf(DoubleNode* node);
+
+  // Functions to link a node in before next (at the end if next is null) and
+  // to unlink a node, keeping the size and the index up to date
+  void linkBefore(DoubleNode* next, DoubleNode* node, int index);
+  void unlink(DoubleNode* node, int index);
+
+  // Function to find the last node before an index on every index level and
+  // the positions of these nodes; nullptr and -1 stand for the head links
+  void findPredecessors(int index, DoubleNode** update, int* rank);
+
+  SkipLink& linkOf(DoubleNode* node, int level) {
+    return node == nullptr ? headLinks[level] : node->links[level];
+  }
+
+  // Function to draw the height of a new node: a node is on each further
+  // level with probability 1/4
+  int randomHeight();
+
+  void indexInsert(DoubleNode* node, int index);
+  void indexErase(DoubleNode* node, int index);
+
+  void valueInsert(DoubleNode* node, int index);
+  void valueErase(DoubleNode* node);
 };
 
+// Function to build the skip list index over the current elements
+void DoubleLinkedList::setIndexTrue() {
+  if (getIndex()) return;
+  linkPool = new SkipLinkPool();
+  headLinks = linkPool->make(kMaxLevels);
+  levels = 0;
+  SkipLink* last[kMaxLevels];
+  int lastPosition[kMaxLevels];
+  for (int level = 0; level < kMaxLevels; level++) {
+    last[level] = &headLinks[level];
+    lastPosition[level] = -1;
+  }
+
+  int position = 0;
+  for (DoubleNode* current = head; current != nullptr;
+       current = current->next, position++) {
+    current->height = randomHeight();
+    if (current->height == 0) continue;
+    current->links = linkPool->make(current->height);
+    for (int level = 0; level < current->height; level++) {
+      last[level]->next = current;
+      last[level]->span = position - lastPosition[level];
+      last[level] = &current->links[level];
+      lastPosition[level] = position;
+    }
+    if (current->height > levels) levels = current->height;
+  }
+}
+
+// Function to drop the skip list index. The links are freed with their pool
+void DoubleLinkedList::setIndexFalse() {
+  if (!getIndex()) return;
+  for (DoubleNode* current = head; current != nullptr;
+       current = current->next) {
+    current->links = nullptr;
+    current->height = 0;
+  }
+  delete linkPool;
+  linkPool = nullptr;
+  headLinks = nullptr;
+  levels = 0;
+}
+
+// Function to build the value index over the current elements
+void DoubleLinkedList::setValueIndexTrue() {
+  if (valueIndex) return;
+  valueIndex = true;
+  values.reserve(size);
+  for (DoubleNode* current = head; current != nullptr;
+       current = current->next) {
+    values[current->element].push_back(current);
+  }
+}
+
+// Function to drop the value index and free its memory
+void DoubleLinkedList::setValueIndexFalse() {
+  valueIndex = false;
+  unordered_map<string_view, vector<DoubleNode*>>().swap(values);
+}
+
+size_t DoubleLinkedList::getValueIndexMemoryUsage() const {
+  if (!valueIndex) return 0;
+  // Every entry is a hash node holding the next pointer, the key, the
+  // vector and the cached hash
+  size_t entry = sizeof(void*) + sizeof(*values.begin()) + sizeof(size_t);
+  size_t bytes = values.bucket_count() * sizeof(void*) + values.size() * entry;
+  for (const auto& value : values) {
+    bytes += value.second.capacity() * sizeof(DoubleNode*);
+  }
+  return bytes;
+}
+
 // Function to add an element to the beginning of the double linked list
 void DoubleLinkedList::addToBeginning(const string& data) {
-  DoubleNode* newNode = new DoubleNode(data);
-  if (head == nullptr) {
-    head = tail = newNode;
-  } else {
-    newNode->next = head;
-    head->prev = newNode;
-    head = newNode;
-  }
+  linkBefore(head, nodes->make(data), 0);
 }
 
 // Function to add an element to the end of the double linked list
 void DoubleLinkedList::addToEnd(const string& data) {
-  DoubleNode* newNode = new DoubleNode(data);
-  if (tail == nullptr) {
-    head = tail = newNode;
-  } else {
-    newNode->prev = tail;
-    tail->next = newNode;
-    tail = newNode;
-  }
+  linkBefore(nullptr, nodes->make(data), size);
 }
 
 // Removes given value from the doubly linked list
 void DoubleLinkedList::removeByValue(const string& value,
                                      string& removedElement) {
   DoubleNode* current = head;
-  while (current != nullptr && current->element != value) {
-    current = current->next;
+  int index = 0;
+  if (valueIndex) {
+    auto found = values.find(value);
+    current = found != values.end() ? found->second.front() : nullptr;
+    if (current != nullptr && getIndex()) index = positionOf(current);
+  } else {
+    while (current != nullptr && current->element != value) {
+      current = current->next;
+      index++;
+    }
   }
 
   if (current != nullptr) {
     removedElement = current->element;
-
-    if (current->prev != nullptr) {
-      current->prev->next = current->next;
-    } else {
-      head = current->next;
-    }
-
-    if (current->next != nullptr) {
-      current->next->prev = current->prev;
-    } else {
-      tail = current->prev;
-    }
-
-    delete current;
+    unlink(current, index);
+    nodes->destroy(current);
   } else {
     removedElement = "";
     if (getPrintErrors()) cerr << "Error: The element was not found.\n";
@@ -113,42 +311,14 @@ int DoubleLinkedList::insertAtIndex(const string& data, int index) {
     if (getPrintErrors()) cerr << "Error: Negative index is not allowed.\n";
     return 0;
   }
-  DoubleNode* newNode = new DoubleNode(data);
-  if (head == nullptr && index == 0) {
-    head = tail = newNode;
-    return 1;
-  } else {
-    DoubleNode* current = head;
-    DoubleNode* previous = nullptr;
-    int count = 0;
-    while (current != nullptr && count < index) {
-      previous = current;
-      current = current->next;
-      count++;
-    }
-
-    if (count == index) {
-      newNode->next = current;
-      newNode->prev = previous;
-
-      if (current != nullptr) {
-        current->prev = newNode;
-      } else {
-        tail = newNode;
-      }
-
-      if (previous != nullptr) {
-        previous->next = newNode;
-      } else {
-        head = newNode;
-      }
-      return 1;
-    } else {
-      if (getPrintErrors()) cerr << "Error: Index is out of range.\n";
-      delete newNode;
-      return 0;
-    }
+  if (index > size) {
+    if (getPrintErrors()) cerr << "Error: Index is out of range.\n";
+    return 0;
   }
+
+  DoubleNode* next = index == size ? nullptr : nodeAt(index);
+  linkBefore(next, nodes->make(data), index);
+  return 1;
 }
 
 // Function to remove an item from the end of the list
@@ -159,15 +329,8 @@ void DoubleLinkedList::removeFromEnd(string& removedElement) {
   } else {
     DoubleNode* lastNode = tail;
     removedElement = lastNode->element;
-
-    if (lastNode->prev != nullptr) {
-      lastNode->prev->next = nullptr;
-      tail = lastNode->prev;
-    } else {
-      head = tail = nullptr;
-    }
-
-    delete lastNode;
+    unlink(lastNode, size - 1);
+    nodes->destroy(lastNode);
   }
 }
 
@@ -179,16 +342,8 @@ void DoubleLinkedList::removeFromBeginning(string& removedElement) {
   } else {
     DoubleNode* firstNode = head;
     removedElement = firstNode->element;
-
-    head = head->next;
-
-    if (head != nullptr) {
-      head->prev = nullptr;
-    } else {
-      tail = nullptr;
-    }
-
-    delete firstNode;
+    unlink(firstNode, 0);
+    nodes->destroy(firstNode);
   }
 }
 
@@ -202,46 +357,37 @@ void DoubleLinkedList::removeAtIndex(int index, string& removedElement) {
   if (head == nullptr) {
     removedElement = "";
     if (getPrintErrors()) cerr << "Error: List is empty\n";
+  } else if (index >= size) {
+    removedElement = "";
+    if (getPrintErrors()) cerr << "Error: Index is out of range.\n";
   } else {
-    DoubleNode* current = head;
-    DoubleNode* previous = nullptr;
-    int count = 0;
-
-    while (current != nullptr && count < index) {
-      previous = current;
-      current = current->next;
-      count++;
-    }
-
-    if (count == index) {
-      removedElement = current->element;
-
-      if (previous == nullptr) {
-        head = current->next;
-
-        if (head != nullptr) {
-          head->prev = nullptr;
-        }
-      } else {
-        previous->next = current->next;
-
-        if (current->next != nullptr) {
-          current->next->prev = previous;
-        } else {
-          tail = previous;
-        }
-      }
+    DoubleNode* current = nodeAt(index);
+    removedElement = current->element;
+    unlink(current, index);
+    nodes->destroy(current);
+  }
+}
 
-      delete current;
-    } else {
-      removedElement = "";
-      if (getPrintErrors()) cerr << "Error: Index is out of range.\n";
-    }
+// Function for getting an element by index
+int DoubleLinkedList::getAtIndex(int index, string& element) {
+  if (index < 0 || index >= size) {
+    element = "";
+    if (getPrintErrors()) cerr << "Error: Index is out of range.\n";
+    return 0;
   }
+  element = nodeAt(index)->element;
+  return 1;
 }
 
 // Function to search for an item in the list
 int DoubleLinkedList::search(const string& value) {
+  if (valueIndex) {
+    auto found = values.find(value);
+    if (found != values.end()) return positionOf(found->second.front());
+    if (getPrintErrors()) cerr << "Error: Value not found.\n";
+    return -1;
+  }
+
   DoubleNode* current = head;
   int index = 0;
 
@@ -258,4 +404,209 @@ int DoubleLinkedList::search(const string& value) {
   }
 }
 
+DoubleNode* DoubleLinkedList::nodeAt(int index) {
+  DoubleNode* current = head;
+  int position = 0;
+  if (getIndex()) {
+    // Descend the index to the last node at or before the index; the
+    // remaining distance on the list is short
+    DoubleNode* node = nullptr;
+    position = -1;
+    for (int level = levels - 1; level >= 0; level--) {
+      SkipLink* link = &linkOf(node, level);
+      while (link->next != nullptr && position + link->span <= index) {
+        position += link->span;
+        node = link->next;
+        link = &node->links[level];
+      }
+    }
+    if (node != nullptr) {
+      current = node;
+    } else {
+      position = 0;
+    }
+  } else if (index > size / 2) {
+    current = tail;
+    for (position = size - 1; position > index; position--) {
+      current = current->prev;
+    }
+    return current;
+  }
+
+  for (; position < index; position++) current = current->next;
+  return current;
+}
+
+int DoubleLinkedList::positionOf(DoubleNode* node) {
+  if (getIndex()) {
+    // Follow the highest link of every node to the end of the list. This is
+    // the search path read backwards, so it takes O(log n) steps on average
+    int after = 0;
+    for (DoubleNode* current = node; current != tail;) {
+      int level = current->height - 1;
+      while (level >= 0 && current->links[level].next == nullptr) level--;
+      if (level >= 0) {
+        after += current->links[level].span;
+        current = current->links[level].next;
+      } else {
+        after++;
+        current = current->next;
+      }
+    }
+    return size - 1 - after;
+  }
+
+  DoubleNode* backward = node;
+  DoubleNode* forward = node;
+  for (int steps = 0;; steps++) {
+    if (backward->prev == nullptr) return steps;
+    if (forward->next == nullptr) return size - 1 - steps;
+    backward = backward->prev;
+    forward = forward->next;
+  }
+}
+
+void DoubleLinkedList::linkBefore(DoubleNode* next, DoubleNode* node,
+                                  int index) {
+  DoubleNode* previous = next != nullptr ? next->prev : tail;
+  node->next = next;
+  node->prev = previous;
+  if (next != nullptr) {
+    next->prev = node;
+  } else {
+    tail = node;
+  }
+  if (previous != nullptr) {
+    previous->next = node;
+  } else {
+    head = node;
+  }
+  size++;
+  if (getIndex()) indexInsert(node, index);
+  if (valueIndex) valueInsert(node, index);
+}
+
+void DoubleLinkedList::unlink(DoubleNode* node, int index) {
+  if (getIndex()) indexErase(node, index);
+  if (valueIndex) valueErase(node);
+  if (node->prev != nullptr) {
+    node->prev->next = node->next;
+  } else {
+    head = node->next;
+  }
+  if (node->next != nullptr) {
+    node->next->prev = node->prev;
+  } else {
+    tail = node->prev;
+  }
+  size--;
+}
+
+void DoubleLinkedList::findPredecessors(int index, DoubleNode** update,
+                                        int* rank) {
+  DoubleNode* node = nullptr;
+  int position = -1;
+  for (int level = levels - 1; level >= 0; level--) {
+    SkipLink* link = &linkOf(node, level);
+    while (link->next != nullptr && position + link->span < index) {
+      position += link->span;
+      node = link->next;
+      link = &node->links[level];
+    }
+    update[level] = node;
+    rank[level] = position;
+  }
+}
+
+int DoubleLinkedList::randomHeight() {
+  random ^= random << 13;
+  random ^= random >> 7;
+  random ^= random << 17;
+  int height = __builtin_ctzll(random | (1ull << 63)) / 2;
+  return height < kMaxLevels ? height : kMaxLevels - 1;
+}
+
+// Function to add a node that was linked in at the index to the skip list
+// index. The links that pass over it get one position longer
+void DoubleLinkedList::indexInsert(DoubleNode* node, int index) {
+  DoubleNode* update[kMaxLevels];
+  int rank[kMaxLevels];
+  node->height = randomHeight();
+  if (node->height > levels) {
+    for (int level = levels; level < node->height; level++) {
+      headLinks[level].next = nullptr;
+    }
+    levels = node->height;
+  }
+  findPredecessors(index, update, rank);
+  if (node->height > 0) node->links = linkPool->make(node->height);
+
+  for (int level = 0; level < levels; level++) {
+    SkipLink& link = linkOf(update[level], level);
+    if (level < node->height) {
+      // The next node was at rank + span and moved one position on
+      node->links[level].next = link.next;
+      node->links[level].span = rank[level] + link.span + 1 - index;
+      link.next = node;
+      link.span = index - rank[level];
+    } else if (link.next != nullptr) {
+      link.span++;
+    }
+  }
+}
+
+// Function to remove a node that is about to be unlinked from the skip list
+// index
+void DoubleLinkedList::indexErase(DoubleNode* node, int index) {
+  DoubleNode* update[kMaxLevels];
+  int rank[kMaxLevels];
+  findPredecessors(index, update, rank);
+  for (int level = 0; level < levels; level++) {
+    SkipLink& link = linkOf(update[level], level);
+    if (link.next == node) {
+      link.span += node->links[level].span - 1;
+      link.next = node->links[level].next;
+    } else if (link.next != nullptr) {
+      link.span--;
+    }
+  }
+  while (levels > 0 && headLinks[levels - 1].next == nullptr) levels--;
+  if (node->height > 0) linkPool->destroy(node->links, node->height);
+  node->links = nullptr;
+  node->height = 0;
+}
+
+// Function to add a node that was linked in at the index to the value index.
+// Nodes added at either end need no search; otherwise the equal nodes are
+// binary searched by their positions
+void DoubleLinkedList::valueInsert(DoubleNode* node, int index) {
+  vector<DoubleNode*>& equal = values[node->element];
+  auto position = equal.end();
+  if (index == 0) {
+    position = equal.begin();
+  } else if (index < size - 1) {
+    position = partition_point(
+        equal.begin(), equal.end(),
+        [&](DoubleNode* other) { return positionOf(other) < index; });
+  }
+  equal.insert(position, node);
+}
+
+// Function to remove a node from the value index. If the key viewed the
+// element of the node, it is moved to the element of the first equal node
+void DoubleLinkedList::valueErase(DoubleNode* node) {
+  auto found = values.find(node->element);
+  vector<DoubleNode*>& equal = found->second;
+  if (equal.size() == 1) {
+    values.erase(found);
+    return;
+  }
+  equal.erase(find(equal.begin(), equal.end(), node));
+  if (found->first.data() == node->element.data()) {
+    auto entry = values.extract(found);
+    entry.key() = entry.mapped().front()->element;
+    values.insert(std::move(entry));
+  }
+}
+
 #endif
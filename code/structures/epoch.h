@@ -0,0 +1,129 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+using namespace std;
+
+// Epoch-based reclamation for structures that are read without locks. A
+// thread pins the global epoch while it follows pointers (EpochGuard), and a
+// writer that unlinks an object retires it together with the epoch it was
+// retired in. The global epoch only moves on when every pinned thread has
+// seen it, so once it is two epochs past the one an object was retired in,
+// no thread can still reach the object and it can be freed.
+//
+// Each thread takes one of kMaxThreads slots the first time it pins and
+// returns it when it exits. Pins can be nested
+class Epoch {
+ public:
+  static constexpr int kMaxThreads = 1024;
+
+  static uint64_t current() { return state().epoch.load(); }
+
+  static void pin();
+  static void unpin();
+
+  // Function to move the global epoch on if every pinned thread has seen it.
+  // Returns the global epoch
+  static uint64_t tryAdvance();
+
+ private:
+  static constexpr uint64_t kIdle = UINT64_MAX;
+
+  struct alignas(64) Slot {
+    atomic<bool> used{false};
+    atomic<uint64_t> epoch{kIdle};  // Epoch the thread pinned, or kIdle
+  };
+
+  struct State {
+    atomic<uint64_t> epoch{1};
+    atomic<int> slotsUsed{0};  // Slots after this one were never taken
+    Slot slots[kMaxThreads];
+  };
+
+  struct Participant {
+    Slot* slot = nullptr;
+    int depth = 0;
+    ~Participant() {
+      if (slot == nullptr) return;
+      slot->epoch.store(kIdle, memory_order_release);
+      slot->used.store(false, memory_order_release);
+    }
+  };
+
+  // The state is never destroyed, so threads that exit after main() can
+  // still return their slots
+  static State& state() {
+    static State* instance = new State();
+    return *instance;
+  }
+
+  static Participant& participant() {
+    thread_local Participant instance;
+    return instance;
+  }
+
+  static Slot* takeSlot();
+};
+
+// Guard to pin the epoch for the time of a scope
+class EpochGuard {
+ public:
+  EpochGuard() { Epoch::pin(); }
+  ~EpochGuard() { Epoch::unpin(); }
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+// The fence orders the published epoch before the reads of the pinned
+// section. A thread that read an old epoch only keeps the epoch from moving
+inline void Epoch::pin() {
+  Participant& self = participant();
+  if (self.depth++ > 0) return;
+  if (self.slot == nullptr) self.slot = takeSlot();
+  self.slot->epoch.store(state().epoch.load(memory_order_relaxed),
+                         memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+inline void Epoch::unpin() {
+  Participant& self = participant();
+  if (--self.depth > 0) return;
+  self.slot->epoch.store(kIdle, memory_order_release);
+}
+
+inline uint64_t Epoch::tryAdvance() {
+  State& global = state();
+  uint64_t epoch = global.epoch.load();
+  atomic_thread_fence(memory_order_seq_cst);
+  int slots = global.slotsUsed.load(memory_order_acquire);
+  for (int i = 0; i < slots; i++) {
+    uint64_t pinned = global.slots[i].epoch.load(memory_order_acquire);
+    if (pinned != kIdle && pinned != epoch) return epoch;
+  }
+  global.epoch.compare_exchange_strong(epoch, epoch + 1);
+  return global.epoch.load();
+}
+
+// Function to take a free slot, waiting if all of them are taken
+inline Epoch::Slot* Epoch::takeSlot() {
+  State& global = state();
+  for (;;) {
+    for (int i = 0; i < kMaxThreads; i++) {
+      bool used = false;
+      if (global.slots[i].used.load(memory_order_relaxed) ||
+          !global.slots[i].used.compare_exchange_strong(used, true)) {
+        continue;
+      }
+      int slots = global.slotsUsed.load();
+      while (slots < i + 1 &&
+             !global.slotsUsed.compare_exchange_weak(slots, i + 1)) {
+      }
+      return &global.slots[i];
+    }
+    this_thread::yield();
+  }
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef FLAT_HASH_H
+#define FLAT_HASH_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "array_simd.h"
+#include "wyhash.h"
+using namespace std;
+
+// FlatHashTable has the interface of HashTable but uses open addressing, so
+// set() does not allocate a node and a lookup does not chase pointers. Keys
+// and values are kept in flat slot arrays next to an array of control bytes,
+// one per slot: kEmpty, kDeleted, or the low 7 bits of the hash of the key in
+// the slot. The slots are split into groups of kGroupSize; a lookup starts
+// at the group chosen by the rest of the hash, compares the control bytes of
+// a whole group with one SSE2 instruction and only compares the keys whose
+// bytes match. Groups are probed quadratically until one has an empty slot.
+// The table grows when more than 7/8 of the slots are used or deleted
+class FlatHashTable {
+ public:
+  static constexpr int kGroupSize = 16;
+
+  FlatHashTable(int capacity = 100, uint64_t seed = 0) : seed(seed) {
+    allocate(slotsFor(capacity));
+  }
+
+  void setPrintErrorsFalse() { printErrors = 0; }
+
+  void setPrintErrorsTrue() { printErrors = 1; }
+
+  int getPrintErrors() const { return printErrors; }
+
+  int getSize() const { return size; }
+
+  // Number of slots
+  int getCapacity() const { return int(control.size()); }
+
+  const string set(string key, string value);
+  const string del(string_view key);
+  const string get(string_view key) const;
+
+  // Function to find the value of a key. The pointer is valid until the
+  // table is changed; nullptr is returned if the key is absent
+  const string* find(string_view key) const;
+
+ private:
+  static constexpr int8_t kEmpty = -128;
+  static constexpr int8_t kDeleted = -2;
+
+  vector<int8_t> control;
+  vector<string> keys;
+  vector<string> values;
+  int size = 0;
+  int deleted = 0;
+  uint64_t seed;
+  int printErrors = 1;  // A flag to control error message printing
+
+  // Smallest power of two number of slots that holds capacity elements
+  static size_t slotsFor(int capacity) {
+    size_t slots = kGroupSize;
+    while (slots / 8 * 7 < size_t(capacity)) slots *= 2;
+    return slots;
+  }
+
+  // Bit i of the result is set if control byte i of the group equals byte
+  static uint32_t match(const int8_t* group, int8_t byte);
+
+  void allocate(size_t slots);
+  void rehash(size_t slots);
+
+  // Function to find the slot of a key, or -1 if it is absent
+  long findSlot(string_view key, uint64_t hash) const;
+};
+
+inline uint32_t FlatHashTable::match(const int8_t* group, int8_t byte) {
+#ifdef ARRAY_SIMD_X86
+  __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+  return uint32_t(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(byte))));
+#else
+  uint32_t mask = 0;
+  for (int i = 0; i < kGroupSize; i++) mask |= uint32_t(group[i] == byte) << i;
+  return mask;
+#endif
+}
+
+// Function to insert or update a key-value pair in the hash table
+inline const string FlatHashTable::set(string key, string value) {
+  uint64_t hash = wyhash(key.data(), key.size(), seed);
+  long slot = findSlot(key, hash);
+  if (slot >= 0) return values[slot] = std::move(value);
+
+  if (size_t(size + deleted + 1) > control.size() / 8 * 7) {
+    // Drop the tombstones if that frees enough slots, otherwise grow
+    rehash(size_t(size + 1) > control.size() / 16 * 7 ? control.size() * 2
+                                                         : control.size());
+  }
+
+  // The first empty or deleted slot on the probe sequence
+  size_t groupMask = control.size() / kGroupSize - 1;
+  size_t group = (hash >> 7) & groupMask;
+  for (size_t step = 1;; step++) {
+    const int8_t* bytes = control.data() + group * kGroupSize;
+    uint32_t free = match(bytes, kEmpty) | match(bytes, kDeleted);
+    if (free != 0) {
+      slot = long(group * kGroupSize + __builtin_ctz(free));
+      break;
+    }
+    group = (group + step) & groupMask;
+  }
+  if (control[slot] == kDeleted) deleted--;
+  control[slot] = int8_t(hash & 0x7F);
+  keys[slot] = std::move(key);
+  values[slot] = std::move(value);
+  size++;
+  return values[slot];
+}
+
+// Function to delete a key-value pair from the hash table
+inline const string FlatHashTable::del(string_view key) {
+  long slot = findSlot(key, wyhash(key.data(), key.size(), seed));
+  if (slot < 0) {
+    if (getPrintErrors()) cerr << "Error: key is empty.";
+    return "";
+  }
+
+  string element = std::move(values[slot]);
+  keys[slot].clear();
+  values[slot].clear();
+  // Groups only lose their empty slots, so if the group of the slot still
+  // has one, no lookup went past it and the slot can become empty again
+  const int8_t* group = control.data() + slot / kGroupSize * kGroupSize;
+  if (match(group, kEmpty) != 0) {
+    control[slot] = kEmpty;
+  } else {
+    control[slot] = kDeleted;
+    deleted++;
+  }
+  size--;
+  return element;
+}
+
+// Retrieves an element from the hash table based on the provided key
+inline const string FlatHashTable::get(string_view key) const {
+  const string* element = find(key);
+  if (element != nullptr) return *element;
+  if (getPrintErrors()) cerr << "Error: key is empty";
+  return "";
+}
+
+inline const string* FlatHashTable::find(string_view key) const {
+  long slot = findSlot(key, wyhash(key.data(), key.size(), seed));
+  return slot >= 0 ? &values[slot] : nullptr;
+}
+
+inline void FlatHashTable::allocate(size_t slots) {
+  control.assign(slots, kEmpty);
+  keys.assign(slots, string());
+  values.assign(slots, string());
+  size = deleted = 0;
+}
+
+// Function to move every element into a table of the given number of slots
+inline void FlatHashTable::rehash(size_t slots) {
+  vector<int8_t> oldControl = std::move(control);
+  vector<string> oldKeys = std::move(keys);
+  vector<string> oldValues = std::move(values);
+  allocate(slots);
+
+  size_t groupMask = slots / kGroupSize - 1;
+  for (size_t i = 0; i < oldControl.size(); i++) {
+    if (oldControl[i] < 0) continue;
+    uint64_t hash = wyhash(oldKeys[i].data(), oldKeys[i].size(), seed);
+    size_t group = (hash >> 7) & groupMask;
+    for (size_t step = 1;; step++) {
+      uint32_t free = match(control.data() + group * kGroupSize, kEmpty);
+      if (free != 0) {
+        size_t slot = group * kGroupSize + __builtin_ctz(free);
+        control[slot] = oldControl[i];
+        keys[slot] = std::move(oldKeys[i]);
+        values[slot] = std::move(oldValues[i]);
+        break;
+      }
+      group = (group + step) & groupMask;
+    }
+    size++;
+  }
+}
+
+inline long FlatHashTable::findSlot(string_view key, uint64_t hash) const {
+  size_t groupMask = control.size() / kGroupSize - 1;
+  size_t group = (hash >> 7) & groupMask;
+  int8_t tag = int8_t(hash & 0x7F);
+  for (size_t step = 1;; step++) {
+    const int8_t* bytes = control.data() + group * kGroupSize;
+    for (uint32_t candidates = match(bytes, tag); candidates != 0;
+         candidates &= candidates - 1) {
+      size_t slot = group * kGroupSize + __builtin_ctz(candidates);
+      if (keys[slot] == key) return long(slot);
+    }
+    if (match(bytes, kEmpty) != 0) return -1;
+    group = (group + step) & groupMask;
+  }
+}
+
+#endif
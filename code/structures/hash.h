@@ -2,7 +2,17 @@
 #ifndef HASH_H
 #define HASH_H
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "node_pool.h"
+#include "wyhash.h"
 using namespace std;
 
 class HashTableNode {
@@ -11,32 +21,56 @@ class HashTableNode {
   string key;
   HashTableNode *next;
 
-  HashTableNode(const string k, const string val)
-      : key(k), element(val), next(nullptr) {}
+  HashTableNode(string k, string val)
+      : element(std::move(val)), key(std::move(k)), next(nullptr) {}
 };
 
+// HashTable class with separate chaining. Keys are hashed with wyhash; a
+// table filled from untrusted input should be given a random seed.
+//
+// The table doubles when it holds more keys than buckets and shrinks when it
+// is less than 1/8 full, but never below the capacity it was created with.
+// It is resized incrementally: the new bucket array becomes the table and
+// every set() and del() moves a few buckets of the old one, so no operation
+// moves the whole table. A bucket is moved as a whole, so until then its
+// keys are found and added in the old bucket.
+//
+// Keys are taken as string_view, so looking up a string literal or a part of
+// a buffer does not build a string, and find() returns a pointer to the
+// stored value instead of a copy
 class HashTable {
  private:
+  static constexpr int kRehashStep = 4;  // Buckets moved per operation
+
   int size;
+  int minSize;
+  int count = 0;
+  uint64_t seed;
   int printErrors = 1;  // A flag to control error message printing
+  HashTableNode **oldTable = nullptr;  // Buckets that are being moved
+  int oldSize = 0;
+  int rehashIndex = 0;  // The next bucket of oldTable to move
+  NodePool<HashTableNode> ownNodes;
+  NodePool<HashTableNode> *nodes = &ownNodes;
 
  public:
   HashTableNode **table;
 
-  HashTable(int capacity = 100) : size(capacity) {
-    table = new HashTableNode *[capacity]();
+  HashTable(int capacity = 100, uint64_t seed = 0)
+      : size(capacity), minSize(capacity), seed(seed) {
+    table = allocate(capacity);
+  }
+
+  // Constructor to allocate the nodes from a shared pool
+  HashTable(NodePool<HashTableNode> &pool, int capacity = 100,
+            uint64_t seed = 0)
+      : HashTable(capacity, seed) {
+    nodes = &pool;
   }
 
   ~HashTable() {
-    for (int i = 0; i < size; ++i) {
-      HashTableNode *current = table[i];
-      while (current) {
-        HashTableNode *temp = current;
-        current = current->next;
-        delete temp;
-      }
-    }
-    delete[] table;
+    clear(table, size);
+    if (oldTable != nullptr) clear(oldTable, oldSize);
   }
 
   void setPrintErrorsFalse() { printErrors = 0; }
@@ -45,60 +79,95 @@ class HashTable {
 
   int getPrintErrors() const { return printErrors; }
 
-  int hash_calc(const string key) const;
-  const string set(const string key, const string value);
-  const string del(const string key);
-  const string get(const string key) const;
-};
+  // Number of buckets of the table, the new one while it is resized
+  int getCapacity() const { return size; }
 
-// Function to calculate the hash value for a given key
-int HashTable::hash_calc(const string key) const {
-  int hash_val = 0;
-  for (int i = 0; i < key.length(); i++) {
-    hash_val += (int)key[i];
+  // Number of key-value pairs
+  int getSize() const { return count; }
+
+  bool isRehashing() const { return oldTable != nullptr; }
+
+  int hash_calc(string_view key) const;
+  const string set(string key, string value);
+  const string del(string_view key);
+  const string get(string_view key) const;
+
+  // Function to find the value of a key. The pointer is valid until the key
+  // is deleted or set again; nullptr is returned if the key is absent
+  const string *find(string_view key) const;
+
+ private:
+  // Bucket arrays come from calloc, which maps large blocks as zero pages
+  // instead of clearing them, so starting a resize of a large table is cheap
+  static HashTableNode **allocate(int buckets) {
+    void *memory = calloc(size_t(buckets), sizeof(HashTableNode *));
+    if (memory == nullptr) throw bad_alloc();
+    return static_cast<HashTableNode **>(memory);
   }
-  return hash_val % size;
-}
 
-// Function to insert or update a key-value pair in the hash table
-const string HashTable::set(const string key, const string value) {
-  int index = hash_calc(key);
-  HashTableNode *newNode = new HashTableNode(key, value);
+  static int bucketOf(uint64_t hash, int buckets) {
+    return int((__uint128_t(hash) * uint64_t(buckets)) >> 64);
+  }
 
-  if (table[index] == nullptr) {
-    table[index] = newNode;
-  } else {
-    HashTableNode *current = table[index];
-    while (current->next != nullptr) {
-      if (current->key == key) {
-        current->element = value;
-        return current->element;
-      }
-      current = current->next;
+  void clear(HashTableNode **buckets, int bucketCount);
+
+  // Function to find the head of the chain that holds a key
+  HashTableNode **chainOf(string_view key) const;
+
+  void startRehash(int buckets);
+  void rehashStep();
+  void moveBucket(int index);
+};
+
+// Function to calculate the bucket of a given key. The 64-bit hash is
+// mapped to [0, size) by taking the high half of hash * size, which needs no
+// division
+int HashTable::hash_calc(string_view key) const {
+  return bucketOf(wyhash(key.data(), key.size(), seed), size);
+}
+
+// Function to insert or update a key-value pair in the hash table. The key
+// and the value are moved into the node
+const string HashTable::set(string key, string value) {
+  rehashStep();
+  HashTableNode **tail = chainOf(key);
+  while (*tail != nullptr) {
+    if ((*tail)->key == key) {
+      (*tail)->element = std::move(value);
+      return (*tail)->element;
     }
-    current->next = newNode;
+    tail = &(*tail)->next;
   }
+  HashTableNode *newNode = *tail =
+      nodes->make(std::move(key), std::move(value));
+  count++;
+  if (!isRehashing() && count > size) startRehash(size * 2);
   return newNode->element;
 }
 
 // Function to delete a key-value pair from the hash table
-const string HashTable::del(const string key) {
-  int index = hash_calc(key);
-  if (table[index] == nullptr) {
+const string HashTable::del(string_view key) {
+  rehashStep();
+  HashTableNode **chain = chainOf(key);
+  if (*chain == nullptr) {
     if (getPrintErrors()) cerr << "Error: key is empty.";
     return "";
   } else {
-    HashTableNode *current = table[index];
+    HashTableNode *current = *chain;
     HashTableNode *prev = nullptr;
     while (current != nullptr) {
       if (current->key == key) {
-        string element = current->element;
+        string element = std::move(current->element);
         if (prev == nullptr) {
-          table[index] = current->next;
+          *chain = current->next;
         } else {
           prev->next = current->next;
         }
-        delete current;
+        nodes->destroy(current);
+        count--;
+        if (!isRehashing() && count < size / 8 && size > minSize) {
+          startRehash(max(count * 2, minSize));
+        }
         return element;
       }
       prev = current;
@@ -109,17 +178,89 @@ const string HashTable::del(const string key) {
 }
 
 // Retrieves an element from the hash table based on the provided key
-const string HashTable::get(const string key) const {
-  int index = hash_calc(key);
-  HashTableNode *current = table[index];
-  while (current != nullptr) {
-    if (current->key == key) {
-      return current->element;
-    }
-    current = current->next;
-  }
+const string HashTable::get(string_view key) const {
+  const string *element = find(key);
+  if (element != nullptr) return *element;
   if (getPrintErrors()) cerr << "Error: key is empty";
   return "";
 }
 
+const string *HashTable::find(string_view key) const {
+  for (HashTableNode *current = *chainOf(key); current != nullptr;
+       current = current->next) {
+    if (current->key == key) return &current->element;
+  }
+  return nullptr;
+}
+
+// Function to free the nodes and the bucket array of a table
+void HashTable::clear(HashTableNode **buckets, int bucketCount) {
+  for (int i = 0; i < bucketCount; ++i) {
+    HashTableNode *current = buckets[i];
+    while (current) {
+      HashTableNode *temp = current;
+      current = current->next;
+      nodes->destroy(temp);
+    }
+  }
+  free(buckets);
+}
+
+// The buckets of oldTable before rehashIndex are empty, and keys are never
+// added to an empty bucket of oldTable, so a key is in its old bucket if
+// that bucket is not empty and in the new table otherwise
+HashTableNode **HashTable::chainOf(string_view key) const {
+  uint64_t hash = wyhash(key.data(), key.size(), seed);
+  if (oldTable != nullptr) {
+    HashTableNode **old = &oldTable[bucketOf(hash, oldSize)];
+    if (*old != nullptr) return old;
+  }
+  return &table[bucketOf(hash, size)];
+}
+
+void HashTable::startRehash(int buckets) {
+  oldTable = table;
+  oldSize = size;
+  rehashIndex = 0;
+  table = allocate(buckets);
+  size = buckets;
+}
+
+// Function to move up to kRehashStep buckets, visiting at most ten times as
+// many empty ones
+void HashTable::rehashStep() {
+  if (oldTable == nullptr) return;
+  int moved = 0;
+  for (int visited = 0; visited < kRehashStep * 10 && moved < kRehashStep &&
+                        rehashIndex < oldSize;
+       visited++, rehashIndex++) {
+    if (oldTable[rehashIndex] != nullptr) {
+      moveBucket(rehashIndex);
+      moved++;
+    }
+  }
+  if (rehashIndex == oldSize) {
+    free(oldTable);
+    oldTable = nullptr;
+    oldSize = 0;
+  }
+}
+
+// Function to move the chain of an old bucket to the new table. Nodes are
+// appended in their order
+void HashTable::moveBucket(int index) {
+  HashTableNode *current = oldTable[index];
+  oldTable[index] = nullptr;
+  while (current != nullptr) {
+    HashTableNode *next = current->next;
+    current->next = nullptr;
+    const string &key = current->key;
+    HashTableNode **tail =
+        &table[bucketOf(wyhash(key.data(), key.size(), seed), size)];
+    while (*tail != nullptr) tail = &(*tail)->next;
+    *tail = current;
+    current = next;
+  }
+}
+
 #endif
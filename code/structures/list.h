@@ -2,33 +2,49 @@
 #define LIST_H
 
 #include <iostream>
+#include <utility>
+
+#include "node_pool.h"
 using namespace std;
 
-// Node class to represent individual elements in the linked list
+// Node class to represent a block of consecutive elements in the linked list.
+// Each node holds up to kCapacity elements, so the list allocates and
+// follows one node per block instead of one per element
 class Node {
  public:
-  string element;
+  static const int kCapacity = 16;
+
+  string elements[kCapacity];
+  int count;
   Node* next;
-  Node(const string& data) : element(data), next(nullptr) {}
+  Node() : count(0), next(nullptr) {}
 };
 
-// LinkedList class to encapsulate the linked list functionality
+// LinkedList class to encapsulate the linked list functionality. The list is
+// unrolled: elements are kept in blocks, a full block is split in half when
+// an element is inserted into it, and a block is merged with the next one
+// when both are at most half full
 class LinkedList {
  private:
   Node* head;
   int printErrors = 1;  // A flag to control error message printing
+  NodePool<Node> ownNodes;
+  NodePool<Node>* nodes = &ownNodes;
 
  public:
   // Constructor to initialize an empty linked list
   LinkedList() : head(nullptr) {}
 
+  // Constructor to allocate the nodes from a shared pool
+  explicit LinkedList(NodePool<Node>& pool) : LinkedList() { nodes = &pool; }
+
   // Destructor to free the memory allocated for the entire linked list
   ~LinkedList() {
     Node* current = head;
     while (current != nullptr) {
       Node* temp = current;
       current = current->next;
-      delete temp;
+      nodes->destroy(temp);
     }
   }
 
@@ -45,17 +61,24 @@ class LinkedList {
   int removeByValue(const string& value);
   int search(const string& element);
   void print();
+
+ private:
+  // Function to find the node and the offset where an element with the
+  // given index is inserted. Returns false if the index is out of range
+  bool locate(int index, Node*& node, int& offset);
+
+  void insertAt(Node* node, int offset, const string& data);
+  void eraseAt(Node* node, Node* previous, int offset, string& element);
 };
 
 // Function to add an element to the beginning of the list
 void LinkedList::add(const string& data) {
-  Node* newNode = new Node(data);
-  if (head == nullptr) {
-    head = newNode;
-  } else {
+  if (head == nullptr || head->count == Node::kCapacity) {
+    Node* newNode = nodes->make();
     newNode->next = head;
     head = newNode;
   }
+  insertAt(head, 0, data);
 }
 
 // Function to insert an element at a specific index in the list
@@ -65,35 +88,18 @@ void LinkedList::insert(const string& data, int index) {
     return;
   }
 
-  Node* newNode = new Node(data);
   if (head == nullptr && index == 0) {
-    head = newNode;
-  } else {
-    Node* current = head;
-    Node* previous = nullptr;
-    int count = 0;
-
-    // Traverse to the specified index
-    while (current != nullptr && count < index) {
-      previous = current;
-      current = current->next;
-      count++;
-    }
+    add(data);
+    return;
+  }
 
-    if (count == index) {
-      // Insert the new node at the specified index
-      newNode->next = current;
-      if (previous != nullptr) {
-        previous->next = newNode;
-      } else {
-        head = newNode;
-      }
-    } else {
-      if (getPrintErrors()) cerr << "Error: Index is out of range.\n";
-      delete newNode;  // Deallocate memory in case of error
-      return;
-    }
+  Node* node;
+  int offset;
+  if (!locate(index, node, offset)) {
+    if (getPrintErrors()) cerr << "Error: Index is out of range.\n";
+    return;
   }
+  insertAt(node, offset, data);
 }
 
 // Function to remove the first element from the list
@@ -102,13 +108,7 @@ void LinkedList::remove(string& element) {
     element = "";
     if (getPrintErrors()) cerr << "Error: List is empty\n";
   } else {
-    Node* temp = head;
-    element = temp->element;
-    head = head->next;
-
-    // Delete the node, which will invoke the Node destructor and free the
-    // string element
-    delete temp;
+    eraseAt(head, nullptr, 0, element);
   }
 }
 
@@ -122,35 +122,22 @@ void LinkedList::removeByIndex(int index, string& element) {
   if (head == nullptr) {
     element = "";
     if (getPrintErrors()) cerr << "Error: List is empty\n";
-  } else {
-    Node* current = head;
-    Node* previous = nullptr;
-    int count = 0;
+    return;
+  }
 
-    // Traverse to the specified index
-    while (current != nullptr && count < index) {
-      previous = current;
-      current = current->next;
-      count++;
-    }
+  Node* previous = nullptr;
+  Node* current = head;
+  while (current != nullptr && index >= current->count) {
+    index -= current->count;
+    previous = current;
+    current = current->next;
+  }
 
-    if (count == index) {
-      // Remove the node at the specified index
-      if (previous == nullptr) {
-        element = head->element;
-        head = current->next;
-      } else {
-        element = current->element;
-        previous->next = current->next;
-
-        // Delete the node, which will invoke the Node destructor and free the
-        // string element
-        delete current;
-      }
-    } else {
-      element = "";
-      if (getPrintErrors()) cerr << "Error: Index is out of range.\n";
-    }
+  if (current == nullptr) {
+    element = "";
+    if (getPrintErrors()) cerr << "Error: Index is out of range.\n";
+  } else {
+    eraseAt(current, previous, index, element);
   }
 }
 
@@ -160,66 +147,113 @@ int LinkedList::removeByValue(const string& value) {
     if (getPrintErrors()) cerr << "Error: List is empty.";
     return 0;
   }
-  Node* current = head;
-  Node* previous = nullptr;
+
   // Traverse the list to find the specified value
-  while (current != nullptr && current->element != value) {
+  Node* previous = nullptr;
+  for (Node* current = head; current != nullptr; current = current->next) {
+    for (int i = 0; i < current->count; i++) {
+      if (current->elements[i] == value) {
+        string removed;
+        eraseAt(current, previous, i, removed);
+        return 1;
+      }
+    }
     previous = current;
-    current = current->next;
-  }
-
-  if (current == nullptr) {
-    if (getPrintErrors()) cerr << "Error: The element was not found." << endl;
-    return 0;
   }
 
-  if (previous == nullptr) {
-    head = head->next;
-    delete current;
-    return 1;
-  } else {
-    // Remove the node with the specified value
-    if (previous == nullptr) {
-      head = current->next;
-    } else {
-      previous->next = current->next;
-
-      // Delete the node, which will invoke the Node destructor and free the
-      // string element
-      delete current;
-      return 1;
-    }
-  }
+  if (getPrintErrors()) cerr << "Error: The element was not found." << endl;
   return 0;
 }
 
 // Function to search for the index of a specific value in the list
 int LinkedList::search(const string& value) {
-  Node* current = head;
   int index = 0;
 
   // Traverse the list to find the specified value
-  while (current != nullptr && current->element != value) {
-    current = current->next;
-    index++;
+  for (Node* current = head; current != nullptr; current = current->next) {
+    for (int i = 0; i < current->count; i++) {
+      if (current->elements[i] == value) return index + i;
+    }
+    index += current->count;
   }
 
-  if (current == nullptr) {
-    if (getPrintErrors()) cerr << "Error: Value not found.\n";
-    return -1;
-  } else {
-    return index;
-  }
+  if (getPrintErrors()) cerr << "Error: Value not found.\n";
+  return -1;
 }
 
 // Function to print the elements of the list
 void LinkedList::print() {
-  Node* current = head;
-  while (current != nullptr) {
-    cout << current->element << " ";
-    current = current->next;
+  for (Node* current = head; current != nullptr; current = current->next) {
+    for (int i = 0; i < current->count; i++) {
+      cout << current->elements[i] << " ";
+    }
   }
   cout << endl;
 }
 
+bool LinkedList::locate(int index, Node*& node, int& offset) {
+  for (node = head; node != nullptr; node = node->next) {
+    if (index < node->count ||
+        (index == node->count && node->next == nullptr)) {
+      offset = index;
+      return true;
+    }
+    index -= node->count;
+  }
+  return false;
+}
+
+// Function to insert an element at an offset of a node, splitting the node
+// if it is full
+void LinkedList::insertAt(Node* node, int offset, const string& data) {
+  if (node->count == Node::kCapacity) {
+    Node* newNode = nodes->make();
+    int half = Node::kCapacity / 2;
+    for (int i = half; i < node->count; i++) {
+      newNode->elements[i - half] = std::move(node->elements[i]);
+    }
+    newNode->count = node->count - half;
+    node->count = half;
+    newNode->next = node->next;
+    node->next = newNode;
+    if (offset > half) {
+      node = newNode;
+      offset -= half;
+    }
+  }
+
+  for (int i = node->count; i > offset; i--) {
+    node->elements[i] = std::move(node->elements[i - 1]);
+  }
+  node->elements[offset] = data;
+  node->count++;
+}
+
+// Function to remove the element at an offset of a node. An empty node is
+// freed, and a node is merged with the next one if they fit into half a node
+void LinkedList::eraseAt(Node* node, Node* previous, int offset,
+                         string& element) {
+  element = std::move(node->elements[offset]);
+  for (int i = offset + 1; i < node->count; i++) {
+    node->elements[i - 1] = std::move(node->elements[i]);
+  }
+  node->elements[--node->count].clear();
+
+  if (node->count == 0) {
+    (previous == nullptr ? head : previous->next) = node->next;
+    nodes->destroy(node);
+    return;
+  }
+
+  Node* next = node->next;
+  if (next != nullptr && node->count + next->count <= Node::kCapacity / 2) {
+    for (int i = 0; i < next->count; i++) {
+      node->elements[node->count + i] = std::move(next->elements[i]);
+    }
+    node->count += next->count;
+    node->next = next->next;
+    nodes->destroy(next);
+  }
+}
+
 #endif
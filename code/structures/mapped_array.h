@@ -0,0 +1,328 @@
+#ifndef MAPPED_ARRAY_H
+#define MAPPED_ARRAY_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+#include "array_simd.h"
+using namespace std;
+
+// Access pattern hints passed to madvise
+enum class MappedAccess { kNormal, kSequential, kRandom };
+
+// MappedArray is an array of trivially copyable elements that lives in a
+// memory-mapped file, so it can be larger than RAM and is available again
+// right after open() without a load step. The file starts with a 24-byte
+// header followed by the elements:
+//
+//   "ARRAYMAP" uint32 version uint32 elementSize uint64 size
+//
+// The file grows geometrically like Array does. The size in the header is
+// written by flush() and close(). Sizes and indices are 64-bit, so an array
+// is only limited by the largest file the system can map
+template <typename T = int>
+class MappedArray {
+  static_assert(is_trivially_copyable<T>::value,
+                "MappedArray elements must be trivially copyable");
+
+ public:
+  static constexpr size_t kHeaderSize = 24;
+
+  MappedArray() = default;
+  MappedArray(const MappedArray&) = delete;
+  MappedArray& operator=(const MappedArray&) = delete;
+  ~MappedArray() { close(); }
+
+  void setPrintErrorsFalse() { printErrors = 0; }
+
+  void setPrintErrorsTrue() { printErrors = 1; }
+
+  int getPrintErrors() const { return printErrors; }
+
+  bool isOpen() const { return fd >= 0; }
+
+  int64_t getSize() const { return size; }
+
+  int64_t getCapacity() const { return capacity; }
+
+  bool open(const string& path);
+  bool flush();
+  bool close();
+  bool setAccess(MappedAccess access);
+
+  int64_t add(T element);
+  int64_t insert(int64_t index, T element);
+  T removeLast();
+  T removeAtIndex(int64_t index);
+  T get(int64_t index) const;
+  T change(int64_t index, T element);
+  int64_t search(const T& element) const;
+
+ private:
+  static constexpr char kMagic[8] = {'A', 'R', 'R', 'A', 'Y', 'M', 'A', 'P'};
+  static constexpr uint32_t kVersion = 1;
+  // Largest capacity whose file length fits in both size_t and off_t
+  static constexpr int64_t kMaxCapacity = int64_t(
+      (min<uint64_t>(SIZE_MAX, INT64_MAX) - kHeaderSize) / sizeof(T));
+
+  int fd = -1;
+  char* mapping = nullptr;
+  size_t length = 0;  // Bytes of the file and the mapping
+  int64_t capacity = 0;
+  int64_t size = 0;
+  MappedAccess access = MappedAccess::kNormal;
+  int printErrors = 1;  // A flag to control error message printing
+
+  // Value returned by functions that fail
+  static T errorValue() {
+    if constexpr (is_arithmetic<T>::value) {
+      return T(-1);
+    } else {
+      return T();
+    }
+  }
+
+  T* data() const { return reinterpret_cast<T*>(mapping + kHeaderSize); }
+
+  // Function to report an error, returning false
+  bool fail(const char* message) const {
+    if (getPrintErrors()) cerr << "Error: " << message << endl;
+    return false;
+  }
+
+  void release();
+  bool checkIndex(int64_t index) const;
+  bool resize(int64_t newCapacity);
+  void writeHeader();
+};
+
+// Function to open the array file, creating an empty one if it does not exist
+template <typename T>
+bool MappedArray<T>::open(const string& path) {
+  close();
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return fail("Unable to open the array file.");
+
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    release();
+    return fail("Unable to open the array file.");
+  }
+  if (status.st_size == 0) {
+    if (!resize(0)) {
+      release();
+      return false;
+    }
+    writeHeader();
+    return true;
+  }
+
+  length = status.st_size;
+  mapping = static_cast<char*>(
+      mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+  if (mapping == MAP_FAILED) {
+    mapping = nullptr;
+    release();
+    return fail("Unable to map the array file.");
+  }
+
+  uint32_t version = 0, elementSize = 0;
+  uint64_t stored = 0;
+  if (length >= kHeaderSize) {
+    memcpy(&version, mapping + 8, sizeof(version));
+    memcpy(&elementSize, mapping + 12, sizeof(elementSize));
+    memcpy(&stored, mapping + 16, sizeof(stored));
+  }
+  uint64_t available = (length - min(length, kHeaderSize)) / sizeof(T);
+  if (length < kHeaderSize || memcmp(mapping, kMagic, 8) != 0 ||
+      version != kVersion || elementSize != sizeof(T) ||
+      stored > available || available > uint64_t(kMaxCapacity)) {
+    release();
+    return fail("Invalid array file.");
+  }
+  capacity = int64_t(available);
+  size = int64_t(stored);
+  return access == MappedAccess::kNormal || setAccess(access);
+}
+
+// Function to write the size and the changed pages to the file
+template <typename T>
+bool MappedArray<T>::flush() {
+  if (!isOpen()) return fail("Array file is not open.");
+  writeHeader();
+  if (msync(mapping, length, MS_SYNC) != 0) {
+    return fail("Unable to write the array file.");
+  }
+  return true;
+}
+
+// Function to flush and close the array file
+template <typename T>
+bool MappedArray<T>::close() {
+  bool flushed = mapping == nullptr || flush();
+  release();
+  return flushed;
+}
+
+// Function to unmap and close the array file without writing it
+template <typename T>
+void MappedArray<T>::release() {
+  if (mapping != nullptr) munmap(mapping, length);
+  if (fd >= 0) ::close(fd);
+  fd = -1;
+  mapping = nullptr;
+  length = 0;
+  capacity = size = 0;
+}
+
+// Function to tell the kernel how the elements will be accessed
+template <typename T>
+bool MappedArray<T>::setAccess(MappedAccess newAccess) {
+  access = newAccess;
+  if (mapping == nullptr) return true;
+  int advice = access == MappedAccess::kSequential ? MADV_SEQUENTIAL
+               : access == MappedAccess::kRandom   ? MADV_RANDOM
+                                                   : MADV_NORMAL;
+  if (madvise(mapping, length, advice) != 0) {
+    return fail("Unable to set the access pattern.");
+  }
+  return true;
+}
+
+// Function to add an element to the end of the array
+template <typename T>
+int64_t MappedArray<T>::add(T element) {
+  return insert(size, element);
+}
+
+// Function to insert an element at a specific index in the array
+template <typename T>
+int64_t MappedArray<T>::insert(int64_t index, T element) {
+  if (!isOpen()) {
+    fail("Array file is not open.");
+    return -1;
+  }
+  if (index < 0 || index > size) {
+    fail(index < 0 ? "Negative index." : "Index is out of size.");
+    return -1;
+  }
+
+  if (size == capacity) {
+    if (capacity == kMaxCapacity) {
+      fail("Array is full.");
+      return -1;
+    }
+    int64_t newCapacity = capacity == 0                ? 1024
+                          : capacity > kMaxCapacity / 2 ? kMaxCapacity
+                                                        : capacity * 2;
+    if (!resize(newCapacity)) return -1;
+  }
+  memmove(data() + index + 1, data() + index, sizeof(T) * (size - index));
+  data()[index] = element;
+  return ++size;
+}
+
+// Function to remove the last element in the array
+template <typename T>
+T MappedArray<T>::removeLast() {
+  if (size == 0) {
+    fail("Array is empty.");
+    return errorValue();
+  }
+  return data()[--size];
+}
+
+// Function to remove an element at a specific index in the array
+template <typename T>
+T MappedArray<T>::removeAtIndex(int64_t index) {
+  if (size == 0 && index == 0) {
+    fail("Array is empty.");
+    return errorValue();
+  }
+  if (!checkIndex(index)) return errorValue();
+
+  T element = data()[index];
+  memmove(data() + index, data() + index + 1, sizeof(T) * (size - index - 1));
+  size--;
+  return element;
+}
+
+// Function to get the value at a specific index in the array
+template <typename T>
+T MappedArray<T>::get(int64_t index) const {
+  if (!checkIndex(index)) return errorValue();
+  return data()[index];
+}
+
+// Function to change the value at a specific index in the array
+template <typename T>
+T MappedArray<T>::change(int64_t index, T element) {
+  if (!checkIndex(index)) return errorValue();
+  data()[index] = element;
+  return element;
+}
+
+// Function to search for an element in the array and return the index of
+// its first occurrence
+template <typename T>
+int64_t MappedArray<T>::search(const T& element) const {
+  size_t index = size > 0 ? scanFind(data(), size_t(size), element) : 0;
+  if (index < size_t(size)) return int64_t(index);
+  fail("Element not found.");
+  return -1;
+}
+
+template <typename T>
+bool MappedArray<T>::checkIndex(int64_t index) const {
+  if (index < 0) return fail("Negative index.");
+  if (index >= size) return fail("Index is out of size.");
+  return true;
+}
+
+// Function to grow the file to hold newCapacity elements and map it again
+template <typename T>
+bool MappedArray<T>::resize(int64_t newCapacity) {
+  size_t newLength = kHeaderSize + size_t(newCapacity) * sizeof(T);
+  if (ftruncate(fd, off_t(newLength)) != 0) {
+    return fail("Unable to grow the array file.");
+  }
+  void* newMapping;
+#ifdef __linux__
+  newMapping = mapping == nullptr
+                   ? mmap(nullptr, newLength, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd, 0)
+                   : mremap(mapping, length, newLength, MREMAP_MAYMOVE);
+#else
+  if (mapping != nullptr) munmap(mapping, length);
+  mapping = nullptr;
+  newMapping =
+      mmap(nullptr, newLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+#endif
+  if (newMapping == MAP_FAILED) return fail("Unable to map the array file.");
+  mapping = static_cast<char*>(newMapping);
+  length = newLength;
+  capacity = newCapacity;
+  if (access != MappedAccess::kNormal) setAccess(access);
+  return true;
+}
+
+template <typename T>
+void MappedArray<T>::writeHeader() {
+  uint32_t version = kVersion, elementSize = sizeof(T);
+  uint64_t stored = size;
+  memcpy(mapping, kMagic, 8);
+  memcpy(mapping + 8, &version, sizeof(version));
+  memcpy(mapping + 12, &elementSize, sizeof(elementSize));
+  memcpy(mapping + 16, &stored, sizeof(stored));
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+using namespace std;
+
+// NodePool allocates nodes of one type from slabs. Freed nodes go to a free
+// list and are reused before a slab is cut further, and the slabs are only
+// returned to the system all at once by release() or the destructor. Slabs
+// start at kFirstSlabNodes nodes and double up to kMaxSlabNodes, so a pool
+// of a small structure stays small.
+//
+// Every structure owns a pool by default; structures of the same thread can
+// share one, e.g. threadLocal(). A pool is not synchronized: nodes must be
+// made and destroyed by the thread that owns the pool
+template <typename Node>
+class NodePool {
+ public:
+  static constexpr size_t kFirstSlabNodes = 8;
+  static constexpr size_t kMaxSlabNodes = 512;
+
+  NodePool() = default;
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+  ~NodePool() { release(); }
+
+  // Pool shared by the structures of the calling thread
+  static NodePool& threadLocal() {
+    thread_local NodePool pool;
+    return pool;
+  }
+
+  template <typename... Args>
+  Node* make(Args&&... args);
+  void destroy(Node* node);
+
+  // Function to free every slab. Nodes that were not destroyed are freed
+  // without running their destructors
+  void release();
+
+  size_t getSlabCount() const { return slabCount; }
+
+  size_t getNodesInUse() const { return nodesInUse; }
+
+  // Number of nodes the slabs can hold
+  size_t getNodeCapacity() const { return nodeCapacity; }
+
+ private:
+  union Slot {
+    Slot* next;
+    alignas(Node) unsigned char storage[sizeof(Node)];
+  };
+
+  struct Slab {
+    Slab* next;
+  };
+
+  static constexpr size_t kAlignment = max(alignof(Slab), alignof(Slot));
+  // Offset of the first slot from the start of its slab
+  static constexpr size_t kSlotOffset =
+      (sizeof(Slab) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+
+  Slab* slabs = nullptr;
+  Slot* freeList = nullptr;
+  Slot* unused = nullptr;  // Slots of the newest slab that were never used
+  Slot* unusedEnd = nullptr;
+  size_t slabCount = 0;
+  size_t nodesInUse = 0;
+  size_t nodeCapacity = 0;
+
+  Slot* takeSlot();
+};
+
+// Function to construct a node in a free slot
+template <typename Node>
+template <typename... Args>
+Node* NodePool<Node>::make(Args&&... args) {
+  Slot* slot = takeSlot();
+  try {
+    Node* node = new (slot->storage) Node(std::forward<Args>(args)...);
+    nodesInUse++;
+    return node;
+  } catch (...) {
+    slot->next = freeList;
+    freeList = slot;
+    throw;
+  }
+}
+
+// Function to destroy a node and put its slot on the free list
+template <typename Node>
+void NodePool<Node>::destroy(Node* node) {
+  if (node == nullptr) return;
+  node->~Node();
+  Slot* slot = reinterpret_cast<Slot*>(node);
+  slot->next = freeList;
+  freeList = slot;
+  nodesInUse--;
+}
+
+template <typename Node>
+void NodePool<Node>::release() {
+  while (slabs != nullptr) {
+    Slab* next = slabs->next;
+    ::operator delete(slabs, align_val_t(kAlignment));
+    slabs = next;
+  }
+  freeList = unused = unusedEnd = nullptr;
+  slabCount = nodesInUse = nodeCapacity = 0;
+}
+
+template <typename Node>
+typename NodePool<Node>::Slot* NodePool<Node>::takeSlot() {
+  if (freeList != nullptr) {
+    Slot* slot = freeList;
+    freeList = slot->next;
+    return slot;
+  }
+  if (unused == unusedEnd) {
+    size_t nodes = min(kFirstSlabNodes << min(slabCount, size_t(16)),
+                       kMaxSlabNodes);
+    void* memory = ::operator new(kSlotOffset + nodes * sizeof(Slot),
+                                  align_val_t(kAlignment));
+    Slab* slab = new (memory) Slab{slabs};
+    slabs = slab;
+    unused = reinterpret_cast<Slot*>(static_cast<char*>(memory) + kSlotOffset);
+    unusedEnd = unused + nodes;
+    slabCount++;
+    nodeCapacity += nodes;
+  }
+  return unused++;
+}
+
+#endif
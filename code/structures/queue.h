@@ -2,6 +2,8 @@
 #define QUEUE_H
 
 #include <iostream>
+
+#include "node_pool.h"
 using namespace std;
 
 class QueueNode {
@@ -16,18 +18,23 @@ class Queue {
  private:
   int size;
   int printErrors = 1;  // A flag to control error message printing
+  NodePool<QueueNode> ownNodes;
+  NodePool<QueueNode> *nodes = &ownNodes;
 
  public:
   QueueNode *head;
   QueueNode *tail;
 
-  Queue() : head(nullptr), tail(nullptr), size(0) {}
+  Queue() : size(0), head(nullptr), tail(nullptr) {}
+
+  // Constructor to allocate the nodes from a shared pool
+  explicit Queue(NodePool<QueueNode> &pool) : Queue() { nodes = &pool; }
 
   ~Queue() {
     while (head) {
       QueueNode *temp = head;
       head = head->next;
-      delete temp;
+      nodes->destroy(temp);
     }
     tail = nullptr;
     size = 0;
@@ -45,7 +52,7 @@ class Queue {
 
 // Push an element into the queue
 void Queue::push(const string element) {
-  QueueNode *node = new QueueNode(element);
+  QueueNode *node = nodes->make(element);
 
   if (!head) {
     head = node;
@@ -72,7 +79,7 @@ string Queue::pop() {
       tail = nullptr;
     }
 
-    delete temp;
+    nodes->destroy(temp);
     return val;
   }
 }
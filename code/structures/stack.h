@@ -2,6 +2,8 @@
 #define STACK_H
 
 #include <iostream>
+
+#include "node_pool.h"
 using namespace std;
 
 class StackNode {
@@ -16,16 +18,21 @@ class Stack {
  private:
   int size;
   int printErrors = 1;  // A flag to control error message printing
+  NodePool<StackNode> ownNodes;
+  NodePool<StackNode> *nodes = &ownNodes;
 
  public:
   StackNode *head;
-  Stack() : head(nullptr), size(0) {}
+  Stack() : size(0), head(nullptr) {}
+
+  // Constructor to allocate the nodes from a shared pool
+  explicit Stack(NodePool<StackNode> &pool) : Stack() { nodes = &pool; }
 
   ~Stack() {
     while (head) {
       StackNode *temp = head;
       head = head->next;
-      delete temp;
+      nodes->destroy(temp);
     }
     size = 0;
   }
@@ -42,7 +49,7 @@ class Stack {
 
 // This function pushes an element onto the stack
 void Stack::push(const string element) {
-  StackNode *node = new StackNode(element);
+  StackNode *node = nodes->make(element);
   if (!head) {
     head = node;
   } else {
@@ -61,7 +68,7 @@ string Stack::pop() {
     string element = head->data;
     StackNode *temp = head;
     head = head->next;
-    delete temp;
+    nodes->destroy(temp);
     size--;
     return element;
   }
@@ -2,6 +2,8 @@
 #define TREE_H
 
 #include <iostream>
+
+#include "node_pool.h"
 using namespace std;
 
 class TreeNode {
@@ -15,18 +17,25 @@ class TreeNode {
 };
 
 class Tree {
+ private:
+  NodePool<TreeNode> ownNodes;
+  NodePool<TreeNode> *nodes = &ownNodes;
+
  public:
   TreeNode *root;
 
   Tree() : root(nullptr) {}
 
+  // Constructor to allocate the nodes from a shared pool
+  explicit Tree(NodePool<TreeNode> &pool) : Tree() { nodes = &pool; }
+
   ~Tree() { clear(root); }
 
   void clear(TreeNode *node) {
     if (node) {
       clear(node->left);
       clear(node->right);
-      delete node;
+      nodes->destroy(node);
     }
   }
 
@@ -41,7 +50,7 @@ class Tree {
 
 // Function to insert a new node with the given key into the tree
 TreeNode *Tree::add(TreeNode *root, int key) {
-  if (root == nullptr) return new TreeNode(key);
+  if (root == nullptr) return nodes->make(key);
 
   TreeNode *current = root, *parent = nullptr;
   while (current != nullptr) {
@@ -52,7 +61,7 @@ TreeNode *Tree::add(TreeNode *root, int key) {
       current = current->right;
   }
 
-  TreeNode *newNode = new TreeNode(key);
+  TreeNode *newNode = nodes->make(key);
   newNode->parent = parent;
   if (key < parent->key)
     parent->left = newNode;
@@ -112,7 +121,7 @@ TreeNode *Tree::del(TreeNode *root, int data) {
       successor->left = nodeToDelete->left;
       successor->left->parent = successor;
     }
-    delete nodeToDelete;
+    nodes->destroy(nodeToDelete);
   }
   return root;
 }
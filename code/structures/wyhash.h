@@ -0,0 +1,101 @@
+#ifndef WYHASH_H
+#define WYHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+using namespace std;
+
+// A port of wyhash (final version 4), a fast 64-bit hash with good
+// distribution: keys are read 8 or 4 bytes at a time and every pair of words
+// is mixed with one 64x64->128-bit multiplication. Tables that take their
+// keys from untrusted input should pass a random seed so collisions cannot
+// be precomputed
+
+namespace wy {
+
+constexpr uint64_t kSecret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+                                 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+inline void multiply(uint64_t& a, uint64_t& b) {
+  __uint128_t product = __uint128_t(a) * b;
+  a = uint64_t(product);
+  b = uint64_t(product >> 64);
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b) {
+  multiply(a, b);
+  return a ^ b;
+}
+
+inline uint64_t read8(const uint8_t* from) {
+  uint64_t word;
+  memcpy(&word, from, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return word;
+}
+
+inline uint64_t read4(const uint8_t* from) {
+  uint32_t word;
+  memcpy(&word, from, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap32(word);
+#endif
+  return word;
+}
+
+// Reads 1 to 3 bytes: the first, the middle and the last one
+inline uint64_t read3(const uint8_t* from, size_t length) {
+  return (uint64_t(from[0]) << 16) | (uint64_t(from[length >> 1]) << 8) |
+         from[length - 1];
+}
+
+}  // namespace wy
+
+inline uint64_t wyhash(const void* key, size_t length, uint64_t seed = 0) {
+  const uint8_t* p = static_cast<const uint8_t*>(key);
+  seed ^= wy::mix(seed ^ wy::kSecret[0], wy::kSecret[1]);
+  uint64_t a, b;
+  if (length <= 16) {
+    if (length >= 4) {
+      size_t shift = (length >> 3) << 2;
+      a = (wy::read4(p) << 32) | wy::read4(p + shift);
+      b = (wy::read4(p + length - 4) << 32) | wy::read4(p + length - 4 - shift);
+    } else if (length > 0) {
+      a = wy::read3(p, length);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t left = length;
+    if (left > 48) {
+      uint64_t second = seed, third = seed;
+      do {
+        seed = wy::mix(wy::read8(p) ^ wy::kSecret[1], wy::read8(p + 8) ^ seed);
+        second = wy::mix(wy::read8(p + 16) ^ wy::kSecret[2],
+                         wy::read8(p + 24) ^ second);
+        third = wy::mix(wy::read8(p + 32) ^ wy::kSecret[3],
+                        wy::read8(p + 40) ^ third);
+        p += 48;
+        left -= 48;
+      } while (left > 48);
+      seed ^= second ^ third;
+    }
+    while (left > 16) {
+      seed = wy::mix(wy::read8(p) ^ wy::kSecret[1], wy::read8(p + 8) ^ seed);
+      p += 16;
+      left -= 16;
+    }
+    a = wy::read8(p + left - 16);
+    b = wy::read8(p + left - 8);
+  }
+  a ^= wy::kSecret[1];
+  b ^= seed;
+  wy::multiply(a, b);
+  return wy::mix(a ^ wy::kSecret[0] ^ length, b ^ wy::kSecret[1]);
+}
+
+#endif
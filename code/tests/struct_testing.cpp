@@ -1,9 +1,17 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+
 #include "../structures/array.h"
+#include "../structures/compressed_array.h"
+#include "../structures/concurrent_hash.h"
 #include "../structures/double_list.h"
+#include "../structures/flat_hash.h"
 #include "../structures/hash.h"
 #include "../structures/list.h"
+#include "../structures/mapped_array.h"
+#include "../structures/node_pool.h"
 #include "../structures/queue.h"
 #include "../structures/stack.h"
 #include "../structures/tree.h"
@@ -178,6 +186,45 @@ TEST(LinkedListTest, SearchTestNotFound) {
   ASSERT_EQ(result, -1);
 }
 
+// Linked list: blocks are split and merged as elements come and go
+TEST(LinkedListTest, UnrolledTest) {
+  LinkedList myList;
+  myList.setPrintErrorsFalse();
+  vector<string> expected;
+  for (int i = 0; i < 300; i++) {
+    string value = to_string(i);
+    if (i % 3 == 0) {
+      myList.add(value);
+      expected.insert(expected.begin(), value);
+    } else {
+      int index = (i * 7) % (expected.size() + 1);
+      myList.insert(value, index);
+      expected.insert(expected.begin() + index, value);
+    }
+  }
+  for (int i = 0; i < 250; i++) {
+    string element;
+    if (i % 2 == 0) {
+      int index = (i * 11) % expected.size();
+      myList.removeByIndex(index, element);
+      ASSERT_EQ(element, expected[index]);
+      expected.erase(expected.begin() + index);
+    } else {
+      ASSERT_EQ(myList.removeByValue(expected[i % expected.size()]), 1);
+      expected.erase(expected.begin() + i % expected.size());
+    }
+  }
+
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(myList.search(expected[i]), int(i));
+  }
+  string element;
+  myList.removeByIndex(expected.size(), element);
+  ASSERT_EQ(element, "");
+  myList.insert("last", expected.size());
+  ASSERT_EQ(myList.search("last"), int(expected.size()));
+}
+
 // ---------------------------------------------------------------
 
 // Doubly linked list: addToBeginning command test
@@ -381,6 +428,138 @@ TEST(DoubleLinkedListTest, searchTestNotFound) {
   ASSERT_EQ(index, -1);
 }
 
+// Doubly linked list: positional edits with and without the skip list index
+TEST(DoubleLinkedListTest, indexTest) {
+  DoubleLinkedList myList;
+  myList.setPrintErrorsFalse();
+  vector<string> expected;
+  for (int i = 0; i < 200; i++) {
+    myList.addToEnd(to_string(i));
+    expected.push_back(to_string(i));
+  }
+  myList.setIndexTrue();
+
+  for (int i = 0; i < 3000; i++) {
+    if (i == 1500) myList.setIndexFalse();
+    if (i == 2000) myList.setIndexTrue();
+    if (i == 2500) myList.setValueIndexTrue();
+    string element;
+    int index = (i * 7919) % (expected.size() + 1);
+    if (i % 3 == 2 && index < int(expected.size())) {
+      myList.removeAtIndex(index, element);
+      ASSERT_EQ(element, expected[index]);
+      expected.erase(expected.begin() + index);
+    } else if (i % 11 == 0) {
+      myList.addToBeginning("b" + to_string(i));
+      expected.insert(expected.begin(), "b" + to_string(i));
+    } else if (i % 13 == 0 && !expected.empty()) {
+      myList.removeFromEnd(element);
+      ASSERT_EQ(element, expected.back());
+      expected.pop_back();
+    } else {
+      ASSERT_EQ(myList.insertAtIndex(to_string(i), index), 1);
+      expected.insert(expected.begin() + index, to_string(i));
+    }
+    index = (i * 31) % expected.size();
+    ASSERT_EQ(myList.getAtIndex(index, element), 1);
+    ASSERT_EQ(element, expected[index]);
+    ASSERT_EQ(myList.search(element),
+              find(expected.begin(), expected.end(), element) -
+                  expected.begin());
+  }
+
+  ASSERT_EQ(myList.getSize(), int(expected.size()));
+  for (size_t i = 0; i < expected.size(); i++) {
+    string element;
+    myList.getAtIndex(i, element);
+    ASSERT_EQ(element, expected[i]);
+  }
+  string element;
+  ASSERT_EQ(myList.getAtIndex(expected.size(), element), 0);
+  myList.removeAtIndex(expected.size(), element);
+  ASSERT_EQ(element, "");
+}
+
+// Doubly linked list: the value index gives the same results as a scan
+TEST(DoubleLinkedListTest, valueIndexTest) {
+  DoubleLinkedList indexed, scanned;
+  indexed.setPrintErrorsFalse();
+  scanned.setPrintErrorsFalse();
+  indexed.setValueIndexTrue();
+  for (int i = 0; i < 500; i++) {
+    indexed.addToEnd(to_string(i % 150));
+    scanned.addToEnd(to_string(i % 150));
+  }
+  ASSERT_GT(indexed.getValueIndexMemoryUsage(), size_t(0));
+
+  for (int i = 0; i < 2000; i++) {
+    if (i == 1000) indexed.setIndexTrue();
+    string value = to_string((i * 37) % 160), fromIndexed, fromScanned;
+    ASSERT_EQ(indexed.search(value), scanned.search(value));
+    if (i % 4 == 0) {
+      indexed.removeByValue(value, fromIndexed);
+      scanned.removeByValue(value, fromScanned);
+    } else if (i % 4 == 1) {
+      indexed.removeFromBeginning(fromIndexed);
+      scanned.removeFromBeginning(fromScanned);
+    } else {
+      indexed.addToEnd(value);
+      scanned.addToEnd(value);
+    }
+    ASSERT_EQ(fromIndexed, fromScanned);
+    ASSERT_EQ(indexed.getSize(), scanned.getSize());
+  }
+
+  indexed.setValueIndexFalse();
+  ASSERT_EQ(indexed.getValueIndexMemoryUsage(), size_t(0));
+  for (int i = 0; i < 160; i++) {
+    ASSERT_EQ(indexed.search(to_string(i)), scanned.search(to_string(i)));
+  }
+}
+
+// Double linked list: value index test - equal values added at the
+// beginning and in the middle are found in list order
+TEST(DoubleLinkedListTest, valueIndexOrderTest) {
+  DoubleLinkedList indexed, scanned;
+  indexed.setPrintErrorsFalse();
+  scanned.setPrintErrorsFalse();
+  indexed.setValueIndexTrue();
+  indexed.addToEnd("a");
+  scanned.addToEnd("a");
+  indexed.addToBeginning("b");
+  scanned.addToBeginning("b");
+  indexed.addToBeginning("a");
+  scanned.addToBeginning("a");
+  ASSERT_EQ(indexed.search("a"), 0);
+
+  for (int i = 0; i < 1000; i++) {
+    string value = to_string(i % 7), fromIndexed, fromScanned;
+    if (i == 500) indexed.setIndexTrue();
+    if (i % 3 == 0) {
+      indexed.addToBeginning(value);
+      scanned.addToBeginning(value);
+    } else if (i % 3 == 1) {
+      int index = (i * 31) % (scanned.getSize() + 1);
+      indexed.insertAtIndex(value, index);
+      scanned.insertAtIndex(value, index);
+    } else if (i % 5 == 0) {
+      indexed.removeByValue(value, fromIndexed);
+      scanned.removeByValue(value, fromScanned);
+    }
+    ASSERT_EQ(indexed.search(value), scanned.search(value));
+  }
+
+  string fromIndexed, fromScanned;
+  while (scanned.getSize() > 0) {
+    indexed.removeFromEnd(fromIndexed);
+    scanned.removeFromEnd(fromScanned);
+    ASSERT_EQ(fromIndexed, fromScanned);
+    for (string value : {"a", "b", "0", "3", "6"}) {
+      ASSERT_EQ(indexed.search(value), scanned.search(value));
+    }
+  }
+}
+
 // ---------------------------------------------------------------
 
 // Array: add command test
@@ -389,14 +568,16 @@ TEST(ArrayTest, addTest) {
   ASSERT_EQ(myArray.add(5), 1);
 }
 
-// Array: add command test - full array
+// Array: add command test - full array grows
 TEST(ArrayTest, addTestFullArray) {
   Array myArray(1);
   myArray.setPrintErrorsFalse();
   myArray.add(2);
   int result = myArray.add(5);
 
-  ASSERT_EQ(result, -1);
+  ASSERT_EQ(result, 2);
+  ASSERT_EQ(myArray.get(1), 5);
+  ASSERT_GE(myArray.getCapacity(), 2);
 }
 
 // Array: insert command test
@@ -421,14 +602,16 @@ TEST(ArrayTest, insertTestNegativeIndex) {
   ASSERT_EQ(error_insert, -1);
 }
 
-// Array: insert command test - full array
+// Array: insert command test - full array grows
 TEST(ArrayTest, insertTestFullArray) {
   Array myArray(1);
   myArray.setPrintErrorsFalse();
   myArray.add(5);
-  int error_insert = myArray.insert(1, 10);
+  int result = myArray.insert(0, 10);
 
-  ASSERT_EQ(error_insert, -1);
+  ASSERT_EQ(result, 2);
+  ASSERT_EQ(myArray.get(0), 10);
+  ASSERT_EQ(myArray.get(1), 5);
 }
 
 // Array: insert command test - out of size
@@ -579,6 +762,325 @@ TEST(ArrayTest, searchTestNotFound) {
   ASSERT_EQ(myArray.search(10), -1);
 }
 
+// Array: growth, reserve and shrink_to_fit test
+TEST(ArrayTest, capacityTest) {
+  Array myArray;
+  for (int i = 0; i < 1000; i++) myArray.add(i);
+  ASSERT_EQ(myArray.getSize(), 1000);
+  ASSERT_EQ(myArray.get(999), 999);
+
+  myArray.reserve(5000);
+  ASSERT_EQ(myArray.getCapacity(), 5000);
+  myArray.removeAtIndex(0);
+  myArray.shrink_to_fit();
+  ASSERT_EQ(myArray.getCapacity(), 999);
+  ASSERT_EQ(myArray.get(0), 1);
+}
+
+// Array: copy and move test
+TEST(ArrayTest, copyMoveTest) {
+  Array<string> first;
+  first.add("First");
+  first.add("Second");
+
+  Array<string> copy(first);
+  copy.change(0, "Changed");
+  ASSERT_EQ(first.get(0), "First");
+
+  Array<string> moved(std::move(first));
+  ASSERT_EQ(moved.get(1), "Second");
+  ASSERT_EQ(first.getSize(), 0);
+
+  first = moved;
+  moved = std::move(copy);
+  ASSERT_EQ(first.get(0), "First");
+  ASSERT_EQ(moved.get(0), "Changed");
+}
+
+// Array: emplace command test
+TEST(ArrayTest, emplaceTest) {
+  Array<string> myArray;
+  myArray.setPrintErrorsFalse();
+  myArray.emplace(0, 3, 'b');
+  myArray.emplace(0, "a");
+  myArray.emplace(2, "c");
+
+  ASSERT_EQ(myArray.get(0), "a");
+  ASSERT_EQ(myArray.get(1), "bbb");
+  ASSERT_EQ(myArray.removeAtIndex(1), "bbb");
+  ASSERT_EQ(myArray.search("c"), 1);
+  ASSERT_EQ(myArray.emplace(5, "d"), -1);
+  ASSERT_EQ(myArray.get(5), "");
+}
+
+// Array: vectorized search, count, min and max test
+TEST(ArrayTest, scanTest) {
+  Array myArray;
+  myArray.setPrintErrorsFalse();
+  ASSERT_EQ(myArray.search(1), -1);
+  ASSERT_EQ(myArray.count(1), 0);
+  ASSERT_EQ(myArray.min(), -1);
+
+  for (int i = 0; i < 1003; i++) myArray.add((i * 37) % 101 - 50);
+  for (int value = -51; value <= 51; value++) {
+    int first = -1, occurrences = 0;
+    for (int i = 0; i < 1003; i++) {
+      if (myArray.get(i) != value) continue;
+      if (first < 0) first = i;
+      occurrences++;
+    }
+    ASSERT_EQ(myArray.search(value), first);
+    ASSERT_EQ(myArray.count(value), occurrences);
+  }
+  myArray.add(-1000);
+  myArray.add(1000);
+  ASSERT_EQ(myArray.min(), -1000);
+  ASSERT_EQ(myArray.max(), 1000);
+  ASSERT_EQ(myArray.search(1000), 1004);
+}
+
+// Array: sorted mode test
+TEST(ArrayTest, sortedTest) {
+  Array myArray;
+  myArray.setPrintErrorsFalse();
+  for (int value : {5, 3, 9, 3, 1}) myArray.add(value);
+  ASSERT_FALSE(myArray.isSorted());
+  myArray.sort();
+  ASSERT_TRUE(myArray.isSorted());
+
+  myArray.add(4);
+  myArray.insert(0, 10);
+  myArray.emplace(6, 3);
+  int expected[] = {1, 3, 3, 3, 4, 5, 9, 10};
+  ASSERT_EQ(myArray.getSize(), 8);
+  for (int i = 0; i < 8; i++) ASSERT_EQ(myArray.get(i), expected[i]);
+  ASSERT_EQ(myArray.search(3), 1);
+  ASSERT_EQ(myArray.search(10), 7);
+  ASSERT_EQ(myArray.search(6), -1);
+  ASSERT_EQ(myArray.search(11), -1);
+  ASSERT_EQ(myArray.count(3), 3);
+  ASSERT_EQ(myArray.min(), 1);
+  ASSERT_EQ(myArray.max(), 10);
+
+  myArray.change(0, 2);
+  ASSERT_TRUE(myArray.isSorted());
+  myArray.change(0, 7);
+  ASSERT_FALSE(myArray.isSorted());
+  ASSERT_EQ(myArray.search(7), 0);
+
+  Array<string> words;
+  for (const char* word : {"pear", "apple", "fig"}) words.add(word);
+  words.sort();
+  words.add("banana");
+  ASSERT_EQ(words.get(1), "banana");
+  ASSERT_EQ(words.search("fig"), 2);
+}
+
+// Array: gap buffer mode test
+TEST(ArrayTest, gapBufferTest) {
+  Array myArray;
+  vector<int> expected;
+  myArray.setGapBufferTrue();
+  int cursor = 0;
+  for (int i = 0; i < 2000; i++) {
+    cursor = (cursor + (i % 7 == 0 ? 13 : 0)) % (expected.size() + 1);
+    if (i % 5 == 4 && cursor > 0) {
+      cursor--;
+      ASSERT_EQ(myArray.removeAtIndex(cursor), expected[cursor]);
+      expected.erase(expected.begin() + cursor);
+    } else {
+      myArray.insert(cursor, i);
+      expected.insert(expected.begin() + cursor, i);
+      cursor++;
+    }
+  }
+  ASSERT_EQ(myArray.getSize(), int(expected.size()));
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(myArray.get(i), expected[i]);
+  }
+  ASSERT_EQ(myArray.search(expected.back()), int(expected.size()) - 1);
+  ASSERT_EQ(myArray.count(expected[0]), 1);
+  ASSERT_EQ(myArray.min(), *min_element(expected.begin(), expected.end()));
+  ASSERT_EQ(myArray.max(), *max_element(expected.begin(), expected.end()));
+
+  Array copy(myArray);
+  myArray.change(0, -5);
+  ASSERT_EQ(myArray.removeLast(), expected.back());
+  myArray.setGapBufferFalse();
+  ASSERT_EQ(myArray.get(0), -5);
+  ASSERT_EQ(myArray.get(1), expected[1]);
+  ASSERT_EQ(copy.get(0), expected[0]);
+  ASSERT_EQ(copy.get(int(expected.size()) - 1), expected.back());
+}
+
+// Array: gap buffer mode test with non-trivial elements
+TEST(ArrayTest, gapBufferStringTest) {
+  Array<string> myArray;
+  myArray.setGapBufferTrue();
+  for (const char* word : {"d", "a", "c"}) myArray.add(word);
+  myArray.insert(1, "b");
+  myArray.insert(1, "e");
+  ASSERT_EQ(myArray.removeAtIndex(3), "a");
+  myArray.insert(0, "f");
+  ASSERT_EQ(myArray.search("c"), 4);
+  myArray.sort();
+  myArray.add("cc");
+  const char* expected[] = {"b", "c", "cc", "d", "e", "f"};
+  ASSERT_EQ(myArray.getSize(), 6);
+  for (int i = 0; i < 6; i++) ASSERT_EQ(myArray.get(i), expected[i]);
+}
+
+// CompressedArray: add, get and search test
+TEST(CompressedArrayTest, addGetSearchTest) {
+  CompressedArray myArray;
+  myArray.setPrintErrorsFalse();
+  vector<int> expected;
+  for (int i = 0; i < 5000; i++) expected.push_back(i % 300 == 0 ? 7 : i % 13);
+  for (int i = 0; i < 5000; i++) expected.push_back(1000000 + 3 * i);
+  for (int i = 0, value = 0; i < 5000; i++) {
+    expected.push_back(value += i % 17 * (i % 5));
+  }
+  for (int i = 0; i < 300; i++) expected.push_back(i % 2 ? INT32_MIN : INT32_MAX);
+  for (int value : expected) myArray.add(value);
+
+  ASSERT_EQ(myArray.getSize(), int(expected.size()));
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(myArray.get(i), expected[i]);
+  }
+  for (int value : {0, 7, 12, 1000000, 1000003, 1014997, INT32_MIN, 13, 5}) {
+    auto found = find(expected.begin(), expected.end(), value);
+    int index = found == expected.end() ? -1 : int(found - expected.begin());
+    ASSERT_EQ(myArray.search(value), index);
+  }
+  ASSERT_EQ(myArray.get(-1), -1);
+  ASSERT_EQ(myArray.get(int(expected.size())), -1);
+
+  myArray.shrink_to_fit();
+  ASSERT_LT(myArray.getMemoryUsage() * 4, expected.size() * sizeof(int));
+}
+
+// MappedArray: flush and reopen test
+TEST(MappedArrayTest, reopenTest) {
+  const string path = "mapped_array_test.bin";
+  remove(path.c_str());
+  {
+    MappedArray myArray;
+    myArray.setPrintErrorsFalse();
+    ASSERT_EQ(myArray.add(1), -1);
+    ASSERT_TRUE(myArray.open(path));
+    ASSERT_TRUE(myArray.setAccess(MappedAccess::kSequential));
+    for (int i = 0; i < 5000; i++) myArray.add(i);
+    myArray.change(10, -10);
+    myArray.insert(0, 42);
+    ASSERT_EQ(myArray.removeAtIndex(1), 0);
+    ASSERT_TRUE(myArray.flush());
+  }
+
+  MappedArray myArray;
+  myArray.setPrintErrorsFalse();
+  ASSERT_TRUE(myArray.open(path));
+  ASSERT_EQ(myArray.getSize(), 5000);
+  ASSERT_EQ(myArray.get(0), 42);
+  ASSERT_EQ(myArray.get(4999), 4999);
+  ASSERT_EQ(myArray.search(-10), 10);
+  ASSERT_EQ(myArray.search(5000), -1);
+  ASSERT_EQ(myArray.get(5000), -1);
+  ASSERT_EQ(myArray.removeLast(), 4999);
+  ASSERT_TRUE(myArray.close());
+
+  MappedArray<double> wrongType;
+  wrongType.setPrintErrorsFalse();
+  ASSERT_FALSE(wrongType.open(path));
+  ASSERT_TRUE(myArray.open(path));
+  ASSERT_EQ(myArray.getSize(), 4999);
+  myArray.close();
+  remove(path.c_str());
+}
+
+// MappedArray: a sparse file with more than INT32_MAX elements
+TEST(MappedArrayTest, largeFileTest) {
+  const string path = "mapped_array_large_test.bin";
+  const int64_t count = int64_t(INT32_MAX) + 16;
+  remove(path.c_str());
+  {
+    MappedArray myArray;
+    ASSERT_TRUE(myArray.open(path));
+    myArray.add(7);
+  }
+
+  // Grow the file without writing the elements and store the new size
+  ASSERT_EQ(truncate(path.c_str(), MappedArray<>::kHeaderSize +
+                                       count * int64_t(sizeof(int))),
+            0);
+  FILE* file = fopen(path.c_str(), "r+b");
+  ASSERT_NE(file, nullptr);
+  uint64_t stored = count;
+  fseek(file, 16, SEEK_SET);
+  fwrite(&stored, sizeof(stored), 1, file);
+  fclose(file);
+
+  MappedArray myArray;
+  myArray.setPrintErrorsFalse();
+  ASSERT_TRUE(myArray.open(path));
+  ASSERT_EQ(myArray.getSize(), count);
+  ASSERT_EQ(myArray.get(0), 7);
+  ASSERT_EQ(myArray.change(count - 1, 42), 42);
+  ASSERT_EQ(myArray.removeLast(), 42);
+  ASSERT_EQ(myArray.add(43), count);
+  ASSERT_EQ(myArray.get(count - 1), 43);
+  ASSERT_EQ(myArray.get(count), -1);
+  ASSERT_TRUE(myArray.close());
+  remove(path.c_str());
+}
+
+// ---------------------------------------------------------------
+
+// Node pool: slabs grow geometrically and freed nodes are reused
+TEST(NodePoolTest, reuseTest) {
+  NodePool<StackNode> pool;
+  vector<StackNode*> made;
+  for (int i = 0; i < 100; i++) made.push_back(pool.make(to_string(i)));
+  ASSERT_EQ(pool.getNodesInUse(), 100u);
+  ASSERT_EQ(pool.getSlabCount(), 4u);  // 8 + 16 + 32 + 64 nodes
+  ASSERT_EQ(pool.getNodeCapacity(), 120u);
+  ASSERT_EQ(made[42]->data, "42");
+
+  StackNode* freed = made[10];
+  pool.destroy(freed);
+  ASSERT_EQ(pool.make("again"), freed);
+  for (StackNode* node : made) pool.destroy(node);
+  ASSERT_EQ(pool.getNodesInUse(), 0u);
+  ASSERT_EQ(pool.getSlabCount(), 4u);
+
+  pool.release();
+  ASSERT_EQ(pool.getSlabCount(), 0u);
+}
+
+// Node pool: structures of a thread share its pool
+TEST(NodePoolTest, sharedPoolTest) {
+  NodePool<QueueNode>& pool = NodePool<QueueNode>::threadLocal();
+  size_t inUse = pool.getNodesInUse();
+  {
+    Queue first(pool), second(pool);
+    for (int i = 0; i < 50; i++) {
+      first.push(to_string(i));
+      second.push(to_string(-i));
+    }
+    ASSERT_EQ(pool.getNodesInUse(), inUse + 100);
+    ASSERT_EQ(first.pop(), "0");
+    ASSERT_EQ(second.pop(), "0");
+    ASSERT_EQ(second.pop(), "-1");
+  }
+  ASSERT_EQ(pool.getNodesInUse(), inUse);
+
+  NodePool<TreeNode> treeNodes;
+  Tree tree(treeNodes);
+  for (int key : {5, 3, 8, 1, 4}) tree.root = tree.add(tree.root, key);
+  tree.root = tree.del(tree.root, 3);
+  ASSERT_EQ(treeNodes.getNodesInUse(), 4u);
+  ASSERT_EQ(tree.search(tree.root, 4)->key, 4);
+}
+
 // ---------------------------------------------------------------
 
 // Stack: push command test
@@ -692,9 +1194,11 @@ TEST(HashTableTest, delTestOneKey) {
   HashTable myHashTable;
   myHashTable.set("key1", "First");
   myHashTable.set("key1", "Second");
+  ASSERT_EQ(myHashTable.getSize(), 1);
   string deleted_value = myHashTable.del("key1");
 
-  ASSERT_EQ(deleted_value, "First");
+  ASSERT_EQ(deleted_value, "Second");
+  ASSERT_EQ(myHashTable.find("key1"), nullptr);
 }
 
 // Hash table: hash_calc command test
@@ -702,7 +1206,181 @@ TEST(HashTableTest, hash_calcTest) {
   HashTable myHashTable;
   int hash = myHashTable.hash_calc("A");
 
-  ASSERT_EQ(hash, 65);
+  ASSERT_GE(hash, 0);
+  ASSERT_LT(hash, 100);
+  ASSERT_EQ(hash, myHashTable.hash_calc("A"));
+}
+
+// Hash table: hash_calc command test - anagrams and sequential keys spread
+TEST(HashTableTest, hash_calcTestDistribution) {
+  HashTable myHashTable(1000);
+  vector<int> chains(1000);
+  for (int i = 0; i < 10000; i++) chains[myHashTable.hash_calc(to_string(i))]++;
+  for (int length : chains) ASSERT_LT(length, 40);
+
+  int collisions = 0;
+  string key = "abcdefgh";
+  for (int i = 0; i < 100; i++) {
+    string anagram = key;
+    next_permutation(key.begin(), key.end());
+    if (myHashTable.hash_calc(anagram) == myHashTable.hash_calc(key)) {
+      collisions++;
+    }
+  }
+  ASSERT_LT(collisions, 5);
+
+  HashTable seeded(1000, 42);
+  int moved = 0;
+  for (int i = 0; i < 100; i++) {
+    string id = "id" + to_string(i);
+    if (seeded.hash_calc(id) != myHashTable.hash_calc(id)) moved++;
+  }
+  ASSERT_GT(moved, 90);
+}
+
+// Hash table: the table grows and shrinks while keys stay reachable
+TEST(HashTableTest, rehashTest) {
+  HashTable myHashTable;
+  myHashTable.setPrintErrorsFalse();
+  bool rehashed = false;
+  for (int i = 0; i < 100000; i++) {
+    myHashTable.set("key" + to_string(i), to_string(i));
+    if (myHashTable.isRehashing() && i % 7 == 0) {
+      rehashed = true;
+      ASSERT_EQ(myHashTable.get("key" + to_string(i / 2)), to_string(i / 2));
+    }
+  }
+  ASSERT_TRUE(rehashed);
+  ASSERT_EQ(myHashTable.getSize(), 100000);
+  ASSERT_GE(myHashTable.getCapacity(), 100000);
+
+  for (int i = 0; i < 100000; i++) {
+    if (i % 100 != 0) {
+      ASSERT_EQ(myHashTable.del("key" + to_string(i)), to_string(i));
+    }
+  }
+  ASSERT_EQ(myHashTable.getSize(), 1000);
+  ASSERT_LT(myHashTable.getCapacity(), 10000);
+  for (int i = 0; i < 100000; i++) {
+    ASSERT_EQ(myHashTable.get("key" + to_string(i)),
+              i % 100 == 0 ? to_string(i) : "");
+  }
+
+  // Setting a key again updates it, also while the table grows
+  myHashTable.set("twice", "First");
+  myHashTable.set("twice", "Second");
+  ASSERT_EQ(myHashTable.getSize(), 1001);
+  for (int i = 0; i < 5000; i++) {
+    myHashTable.set(to_string(i), "");
+    if (i == 2500) myHashTable.set("twice", "Third");
+  }
+  ASSERT_EQ(myHashTable.getSize(), 6001);
+  ASSERT_EQ(myHashTable.del("twice"), "Third");
+  ASSERT_EQ(myHashTable.find("twice"), nullptr);
+}
+
+// Hash table: find command test - string_view keys and moved values
+TEST(HashTableTest, findTest) {
+  HashTable myHashTable;
+  FlatHashTable flatHashTable;
+  string key = "key1", value(100, 'v');
+  myHashTable.set(key, value);
+  flatHashTable.set(std::move(key), std::move(value));
+
+  string_view buffer = "key1key2";
+  const string *found = myHashTable.find(buffer.substr(0, 4));
+  ASSERT_NE(found, nullptr);
+  ASSERT_EQ(*found, string(100, 'v'));
+  ASSERT_EQ(found, myHashTable.find("key1"));
+  ASSERT_EQ(myHashTable.find(buffer.substr(4)), nullptr);
+
+  found = flatHashTable.find(buffer.substr(0, 4));
+  ASSERT_NE(found, nullptr);
+  ASSERT_EQ(*found, string(100, 'v'));
+  ASSERT_EQ(flatHashTable.find(buffer.substr(4)), nullptr);
+  ASSERT_EQ(flatHashTable.del(buffer.substr(0, 4)), string(100, 'v'));
+  ASSERT_EQ(flatHashTable.find("key1"), nullptr);
+}
+
+// Concurrent hash table: readers only see whole values while writers set,
+// delete and grow the table
+TEST(ConcurrentHashTableTest, stressTest) {
+  ConcurrentHashTable myHashTable(16);
+  myHashTable.setPrintErrorsFalse();
+  const int kWriters = 4, kReaders = 4, kKeys = 4000, kRounds = 5;
+  atomic<bool> done{false};
+  atomic<int> badReads{0};
+  vector<thread> writers, readers;
+  for (int w = 0; w < kWriters; w++) {
+    writers.emplace_back([&, w] {
+      for (int round = 0; round < kRounds; round++) {
+        for (int i = w; i < kKeys; i += kWriters) {
+          string key = "key" + to_string(i);
+          myHashTable.set(key, key + ":" + to_string(round));
+          if (i % 3 == 0) myHashTable.del(key);
+          myHashTable.set("hot", "hot:" + to_string(w));
+        }
+      }
+    });
+  }
+  for (int r = 0; r < kReaders; r++) {
+    readers.emplace_back([&, r] {
+      string value;
+      while (!done.load()) {
+        for (int i = r; i < kKeys; i += kReaders) {
+          string key = i % 2 ? "key" + to_string(i) : "hot";
+          if (myHashTable.find(key, value) &&
+              value.compare(0, key.size() + 1, key + ":") != 0) {
+            badReads++;
+          }
+        }
+      }
+    });
+  }
+  for (thread& writer : writers) writer.join();
+  done = true;
+  for (thread& reader : readers) reader.join();
+
+  ASSERT_EQ(badReads.load(), 0);
+  ASSERT_GT(myHashTable.getCapacity(), 16);
+  ASSERT_EQ(myHashTable.getSize(), kKeys - (kKeys + 2) / 3 + 1);
+  for (int i = 0; i < kKeys; i++) {
+    string key = "key" + to_string(i);
+    ASSERT_EQ(myHashTable.get(key),
+              i % 3 == 0 ? "" : key + ":" + to_string(kRounds - 1));
+  }
+  ASSERT_EQ(myHashTable.get("hot").compare(0, 4, "hot:"), 0);
+}
+
+// Flat hash table: random sets, gets and deletes match a reference map
+TEST(FlatHashTableTest, referenceTest) {
+  FlatHashTable myHashTable(4);
+  myHashTable.setPrintErrorsFalse();
+  unordered_map<string, string> expected;
+  uint64_t random = 12345;
+  for (int i = 0; i < 50000; i++) {
+    random = random * 6364136223846793005ull + 1442695040888963407ull;
+    string key = "key" + to_string((random >> 33) % 3000);
+    int operation = (random >> 20) % 3;
+    if (operation == 0) {
+      ASSERT_EQ(myHashTable.set(key, to_string(i)), to_string(i));
+      expected[key] = to_string(i);
+    } else if (operation == 1) {
+      auto found = expected.find(key);
+      ASSERT_EQ(myHashTable.del(key),
+                found == expected.end() ? "" : found->second);
+      if (found != expected.end()) expected.erase(found);
+    } else {
+      auto found = expected.find(key);
+      ASSERT_EQ(myHashTable.get(key),
+                found == expected.end() ? "" : found->second);
+    }
+    ASSERT_EQ(myHashTable.getSize(), int(expected.size()));
+  }
+  ASSERT_LE(myHashTable.getCapacity(), 8192);
+  for (const auto& element : expected) {
+    ASSERT_EQ(myHashTable.get(element.first), element.second);
+  }
 }
 
 // Hash table: get command test
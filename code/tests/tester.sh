@@ -40,3 +40,51 @@ fi
 rm real_result_file_3.txt calc_file_3.txt
 
 echo "\nCalculator tests completed."
+
+# Run the same test files through a calculator server and its client
+../calculator --serve calc_test.sock &
+SERVER_PID=$!
+while [ ! -S calc_test.sock ]; do sleep 0.1; done
+
+echo -n "\nServer test:\nCalculator result: "
+../calculator --client calc_test.sock < test_file_2 > calc_server.txt
+cat calc_server.txt
+echo "9" >> real_result_server.txt
+echo "Real result: 9"
+if diff -s calc_server.txt real_result_server.txt > /dev/null; 
+    then echo "TEST: PASSED";
+else
+    echo "TEST:ERROR";
+fi
+rm real_result_server.txt calc_server.txt
+
+echo -n "\nServer test (line too long):\nCalculator result: "
+head -c 2000000 /dev/zero | tr '\0' 'a' | ../calculator --client calc_test.sock > calc_server.txt
+cat calc_server.txt
+echo "Error: Line is too long." >> real_result_server.txt
+echo "Real result: Error: Line is too long."
+if diff -s calc_server.txt real_result_server.txt > /dev/null; 
+    then echo "TEST: PASSED";
+else
+    echo "TEST:ERROR";
+fi
+rm real_result_server.txt calc_server.txt
+
+echo -n "\nServer test (replies larger than 1 MiB):\nCalculator result: "
+(echo "PUSH 123456"; yes PRINT | head -1000000) > calc_server_batch.txt
+timeout 60 ../calculator --client calc_test.sock < calc_server_batch.txt \
+    > calc_server.txt
+wc -l < calc_server.txt
+yes 123456 | head -1000000 > real_result_server.txt
+echo "Real result: 1000000"
+if diff -s calc_server.txt real_result_server.txt > /dev/null; 
+    then echo "TEST: PASSED";
+else
+    echo "TEST:ERROR";
+fi
+rm real_result_server.txt calc_server.txt calc_server_batch.txt
+
+kill $SERVER_PID
+wait $SERVER_PID 2>/dev/null
+
+echo "\nServer tests completed."
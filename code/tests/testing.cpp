@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 
+#include <thread>
+
 #include "../calculator.h"
+#include "../parallel.h"
+#include "../session.h"
+#include "../snapshot.h"
 
 // ---------------------------------------------------------------
 
@@ -94,6 +99,103 @@ TEST(DefineCommandTest, value10_dot_0) {
   ASSERT_EQ(context.definedParameters["x"], 10.0);
 }
 
+// Test DefineExpressionCommand with lazy evaluation
+TEST(DefineCommandTest, expression) {
+  ExecutionContext context;
+  DefineCommand("a", 2).execute(context);
+  DefineCommand("b", 3).execute(context);
+  DefineExpressionCommand("c", ParameterExpression<Number>::parse(
+                                   {"a", "b", "+", "2", "*"}))
+      .execute(context);
+
+  ASSERT_FALSE(context.derivedParameters["c"].valid);
+  ASSERT_EQ(context.parameterValue("c"), 10);
+  ASSERT_TRUE(context.derivedParameters["c"].valid);
+}
+
+// Test that redefining a parameter only invalidates the values downstream
+TEST(DefineCommandTest, incrementalRecomputation) {
+  ExecutionContext context;
+  processCommand("DEFINE a 4", context);
+  processCommand("DEFINE b 9", context);
+  processCommand("DEFINE ra a SQRT", context);
+  processCommand("DEFINE rb b SQRT", context);
+  processCommand("DEFINE sum ra rb +", context);
+  ASSERT_EQ(context.parameterValue("sum"), 5);
+
+  processCommand("DEFINE a 16", context);
+
+  ASSERT_FALSE(context.derivedParameters["ra"].valid);
+  ASSERT_FALSE(context.derivedParameters["sum"].valid);
+  ASSERT_TRUE(context.derivedParameters["rb"].valid);
+  processCommand("PUSH sum", context);
+  ASSERT_EQ(context.operandStack.top(), 7);
+}
+
+// Test that a long chain of derived parameters is evaluated without deep
+// recursion, also when the chain is closed into a cycle
+TEST(DefineCommandTest, longChain) {
+  ExecutionContext context;
+  ostringstream output;
+  context.errors = &output;
+  const int kChain = 100000;
+  const string last = "p" + to_string(kChain - 1);
+  processCommand("DEFINE p0 1", context);
+  for (int i = 1; i < kChain; i++) {
+    processCommand(
+        "DEFINE p" + to_string(i) + " p" + to_string(i - 1) + " 1 +",
+        context);
+  }
+  ASSERT_EQ(context.parameterValue(last), kChain);
+
+  processCommand("DEFINE p0 " + last + " 1 +", context);
+  processCommand("PUSH " + last, context);
+  ASSERT_EQ(output.str(), "Error: Cyclic definition of parameter " + last +
+                              ".\n");
+  ASSERT_TRUE(context.operandStack.empty());
+
+  processCommand("DEFINE p0 2", context);
+  processCommand("PUSH " + last, context);
+  ASSERT_EQ(context.operandStack.top(), kChain + 1);
+}
+
+// Test DEFINE expressions with invalid input and cycles
+TEST(DefineCommandTest, expressionErrors) {
+  ExecutionContext context;
+  ostringstream output;
+  context.errors = &output;
+
+  processCommand("DEFINE x y +", context);
+  processCommand("DEFINE p q 1 +", context);
+  processCommand("DEFINE q p 1 +", context);
+  processCommand("PUSH p", context);
+  processCommand("DEFINE q 1", context);
+  processCommand("PUSH p", context);
+
+  ASSERT_EQ(output.str(),
+            "Error: Invalid parameter expression.\n"
+            "Error: Cyclic definition of parameter p.\n");
+  ASSERT_EQ(context.operandStack.top(), 2);
+}
+
+// Test that DEFINE of inf and nan defines numbers, while a name that only
+// starts like a number is a parameter
+TEST(DefineCommandTest, infAndNan) {
+  ExecutionContext context;
+  processCommand("DEFINE x inf", context);
+  processCommand("DEFINE y -inf", context);
+  processCommand("DEFINE z nan", context);
+  processCommand("DEFINE nancy 2", context);
+  processCommand("DEFINE w nancy", context);
+
+  ASSERT_EQ(context.derivedParameters.size(), 1);
+  ASSERT_TRUE(std::isinf(context.definedParameters["x"]));
+  ASSERT_GT(context.definedParameters["x"], 0);
+  ASSERT_LT(context.definedParameters["y"], 0);
+  ASSERT_TRUE(std::isnan(context.definedParameters["z"]));
+  ASSERT_EQ(context.parameterValue("w"), 2);
+}
+
 // ---------------------------------------------------------------
 
 // Test SqrtCommand with a value 4
@@ -292,6 +394,579 @@ TEST(DivCommandTest, value0) {
 
 // ---------------------------------------------------------------
 
+// Test SumCommand over the whole stack
+TEST(ReductionCommandTest, sumWholeStack) {
+  SumCommand sumCommand;
+  ExecutionContext context;
+  for (int i = 1; i <= 1001; i++) context.operandStack.push(i);
+
+  sumCommand.execute(context);
+
+  ASSERT_EQ(context.operandStack.size(), 1);
+  ASSERT_EQ(context.operandStack.top(), 501501);
+}
+
+// Test the reductions over the top values of the stack
+TEST(ReductionCommandTest, topValues) {
+  ExecutionContext context;
+  for (int i = 1; i <= 7; i++) context.operandStack.push(i);
+
+  ProdCommand(3).execute(context);
+  ASSERT_EQ(context.operandStack.top(), 210);
+  MinCommand(3).execute(context);
+  ASSERT_EQ(context.operandStack.top(), 3);
+  MaxCommand(2).execute(context);
+  ASSERT_EQ(context.operandStack.top(), 3);
+  MeanCommand().execute(context);
+  ASSERT_EQ(context.operandStack.top(), 2);
+  ASSERT_EQ(context.operandStack.size(), 1);
+}
+
+// Test DotCommand with two segments of the stack
+TEST(ReductionCommandTest, dot) {
+  DotCommand dotCommand(3);
+  ExecutionContext context;
+  context.operandStack.push(100);
+  for (int i = 1; i <= 6; i++) context.operandStack.push(i);
+
+  dotCommand.execute(context);
+
+  ASSERT_EQ(context.operandStack.size(), 2);
+  ASSERT_EQ(context.operandStack.top(), 1 * 4 + 2 * 5 + 3 * 6);
+}
+
+// Test the reductions with too few operands
+TEST(ReductionCommandTest, insufficientOperands) {
+  ExecutionContext context;
+  ASSERT_THROW(SumCommand().execute(context), std::runtime_error);
+  context.operandStack.push(1);
+  ASSERT_THROW(MaxCommand(2).execute(context), std::runtime_error);
+  ASSERT_THROW(DotCommand().execute(context), std::runtime_error);
+  ASSERT_EQ(context.operandStack.size(), 1);
+}
+
+// Test the vectorized kernels against a scalar loop for every tail length
+TEST(ReductionCommandTest, kernelsMatchScalar) {
+  for (size_t n = 1; n <= 40; n++) {
+    vector<float> values(2 * n);
+    for (size_t i = 0; i < values.size(); i++) values[i] = (i * 7 % 11) - 5.0f;
+    float sum = 0, dot = 0, low = values[0], high = values[0];
+    for (size_t i = 0; i < n; i++) {
+      sum += values[i];
+      dot += values[i] * values[n + i];
+      low = min(low, values[i]);
+      high = max(high, values[i]);
+    }
+    ASSERT_EQ(reduceSum(values.data(), n), sum);
+    ASSERT_EQ(reduceDot(values.data(), values.data() + n, n), dot);
+    ASSERT_EQ(reduceMin(values.data(), n), low);
+    ASSERT_EQ(reduceMax(values.data(), n), high);
+  }
+}
+
+// Test the reduction commands through the factory
+TEST(ReductionCommandTest, factory) {
+  ExecutionContext context;
+  ostringstream output;
+  context.output = &output;
+  context.errors = &output;
+
+  for (int i = 1; i <= 4; i++) processCommand("PUSH " + to_string(i), context);
+  processCommand("SUM 0", context);
+  processCommand("SUM 2", context);
+  processCommand("PRINT", context);
+  processCommand("SUM", context);
+  processCommand("PRINT", context);
+
+  ASSERT_EQ(output.str(),
+            "Error: Reduction commands require an optional positive count.\n"
+            "7\n10\n");
+}
+
+// Test the stack depth limit
+TEST(ResourceGovernorTest, stackDepth) {
+  ExecutionContext context;
+  context.governor.limits.maxStackDepth = 2;
+  PushCommand pushCommand(1);
+
+  pushCommand.execute(context);
+  pushCommand.execute(context);
+
+  ASSERT_THROW(pushCommand.execute(context), ResourceLimitError);
+  ASSERT_EQ(context.operandStack.size(), 2);
+}
+
+// Test the parameter limit, which allows redefining existing parameters
+TEST(ResourceGovernorTest, parameterCount) {
+  ExecutionContext context;
+  context.governor.limits.maxParameters = 1;
+  DefineCommand("a", 1).execute(context);
+  DefineCommand("a", 2).execute(context);
+
+  ASSERT_THROW(DefineCommand("b", 3).execute(context), ResourceLimitError);
+  ASSERT_EQ(context.definedParameters.size(), 1);
+}
+
+// Test the command limit through the catch-and-continue path
+TEST(ResourceGovernorTest, commandCount) {
+  ExecutionContext context;
+  ostringstream output;
+  context.output = &output;
+  context.errors = &output;
+  context.governor.limits.maxCommands = 3;
+
+  processCommand("PUSH 1", context);
+  processCommand("PUSH 2", context);
+  processCommand("+", context);
+  processCommand("PRINT", context);
+  processCommand("PRINT", context);
+
+  ASSERT_EQ(output.str(),
+            "Error: Command limit exceeded.\nError: Command limit exceeded.\n");
+}
+
+// Test the wall time limit, which is checked once per interval of commands
+TEST(ResourceGovernorTest, wallTime) {
+  ResourceGovernor governor;
+  governor.limits.maxWallTime = chrono::milliseconds(1);
+  governor.chargeCommand();
+  this_thread::sleep_for(chrono::milliseconds(5));
+
+  for (size_t i = 2; i < ResourceGovernor::kClockCheckInterval; i++) {
+    governor.chargeCommand();
+  }
+  ASSERT_THROW(governor.chargeCommand(), ResourceLimitError);
+  ASSERT_THROW(governor.chargeCommand(), ResourceLimitError);
+}
+
+// Test that a session is not charged for the time it waits between lines
+TEST(ResourceGovernorTest, idleSession) {
+  ExecutionContext context;
+  ostringstream output;
+  context.output = &output;
+  context.errors = &output;
+  context.governor.limits.maxWallTime = chrono::milliseconds(50);
+  SessionInput input;
+  SessionTask session = executeSession(input, context);
+
+  input.append("PUSH 1\n", 7);
+  input.wake();
+  this_thread::sleep_for(chrono::milliseconds(100));
+  string batch;
+  for (size_t i = 0; i < 2 * ResourceGovernor::kClockCheckInterval; i++) {
+    batch += "PUSH 1\n";
+  }
+  batch += "SUM\nPRINT\n";
+  input.append(batch.data(), batch.size());
+  input.wake();
+
+  ASSERT_EQ(output.str(), "2049\n");
+}
+
+// Test that the time of the runs between pauses adds up
+TEST(ResourceGovernorTest, pausedRuns) {
+  ResourceGovernor governor;
+  governor.limits.maxWallTime = chrono::milliseconds(5);
+  governor.chargeCommand();
+  this_thread::sleep_for(chrono::milliseconds(3));
+  governor.pause();
+  this_thread::sleep_for(chrono::milliseconds(20));
+
+  ASSERT_NO_THROW(governor.chargeCommand());
+  this_thread::sleep_for(chrono::milliseconds(3));
+  governor.pause();
+  ASSERT_THROW(governor.chargeCommand(), ResourceLimitError);
+}
+
+// Test that the tracer records the phases of every sampled line
+TEST(TracerTest, sampledLines) {
+  Tracer tracer(2);
+  ExecutionContext context;
+  context.tracer = &tracer;
+
+  for (int i = 0; i < 4; i++) {
+    tracer.beginLine();
+    processCommand("PUSH 1", context);
+  }
+
+  ASSERT_EQ(tracer.getEventCount(), 6);  // tokenize, create and execute
+  ostringstream json;
+  tracer.write(json);
+  ASSERT_EQ(json.str().rfind("{\"traceEvents\":[", 0), 0);
+  ASSERT_NE(json.str().find("\"name\":\"execute\",\"cat\":\"calculator\","
+                            "\"ph\":\"X\""),
+            string::npos);
+}
+
+// Test that spans of different threads get different lanes
+TEST(TracerTest, threadLanes) {
+  Tracer tracer;
+  auto work = [&tracer]() {
+    tracer.beginLine();
+    TraceSpan span(&tracer, "execute");
+  };
+  thread first(work);
+  first.join();
+  thread second(work);
+  second.join();
+
+  ostringstream json;
+  tracer.write(json);
+  ASSERT_NE(json.str().find("\"tid\":0}"), string::npos);
+  ASSERT_NE(json.str().find("\"tid\":1}"), string::npos);
+}
+
+// ---------------------------------------------------------------
+
+// Test an engine instantiated for float
+TEST(NumericTypeTest, floatEngine) {
+  BasicExecutionContext<float> context;
+  ostringstream output;
+  context.output = &output;
+
+  processCommand("PUSH 2.25", context);
+  processCommand("SQRT", context);
+  processCommand("PRINT", context);
+
+  ASSERT_EQ(output.str(), "1.5\n");
+}
+
+// Test an engine instantiated for long double
+TEST(NumericTypeTest, longDoubleEngine) {
+  BasicExecutionContext<long double> context;
+  processCommand("DEFINE a 1", context);
+  processCommand("PUSH a", context);
+  processCommand("PUSH 4", context);
+  processCommand("/", context);
+
+  ASSERT_EQ(context.operandStack.top(), 0.25L);
+}
+
+// Test Fixed64 arithmetic
+TEST(NumericTypeTest, fixedArithmetic) {
+  Fixed64 a = NumericTraits<Fixed64>::parse("-10.25");
+  Fixed64 b = NumericTraits<Fixed64>::parse("0.5");
+
+  ASSERT_EQ(a + b, NumericTraits<Fixed64>::parse("-9.75"));
+  ASSERT_EQ(a * b, NumericTraits<Fixed64>::parse("-5.125"));
+  ASSERT_EQ(a / b, Fixed64(-41) / Fixed64(2));
+  ASSERT_EQ(sqrt(Fixed64(9)), Fixed64(3));
+}
+
+// Test the division of a sum by an element count larger than INT_MAX, as
+// done by MEAN
+TEST(NumericTypeTest, divideByLargeCount) {
+  size_t count = size_t(3) << 30;
+  ASSERT_EQ(NumericTraits<double>::divideByCount(3.0 * count, count), 3.0);
+  ASSERT_EQ(NumericTraits<float>::divideByCount(3.0f * count, count), 3.0f);
+  ASSERT_EQ(NumericTraits<Fixed64>::divideByCount(Fixed64(3), count),
+            Fixed64::fromRaw(4));
+  ASSERT_EQ(NumericTraits<Fixed64>::divideByCount(Fixed64(-10), 4),
+            NumericTraits<Fixed64>::parse("-2.5"));
+}
+
+// Test an engine instantiated for Fixed64
+TEST(NumericTypeTest, fixedEngine) {
+  BasicExecutionContext<Fixed64> context;
+  ostringstream output;
+  context.output = &output;
+  context.errors = &output;
+
+  processCommand("PUSH 2.25", context);
+  processCommand("SQRT", context);
+  processCommand("PRINT", context);
+  processCommand("PUSH 0", context);
+  processCommand("/", context);
+  processCommand("PUSH 1e3", context);
+
+  ASSERT_EQ(output.str(),
+            "1.5\nError: An attempt to divide by 0.\n"
+            "Error: Invalid fixed-point number.\n");
+}
+
+// ---------------------------------------------------------------
+
+// Function to run a script sequentially or in parallel and collect what it
+// prints and the final stack
+static string runScript(const vector<string>& lines, size_t threads) {
+  ExecutionContext context;
+  ostringstream output;
+  context.output = &output;
+  context.errors = &output;
+  if (threads == 0) {
+    for (const string& line : lines) processCommand(line, context);
+  } else {
+    executeScriptParallel(lines, context, threads);
+  }
+  while (!context.operandStack.empty()) {
+    output << context.operandStack.top() << ' ';
+    context.operandStack.pop();
+  }
+  return output.str();
+}
+
+// Test that a parallel run prints the same values and errors in the same
+// order as a sequential run
+TEST(ParallelScriptTest, matchesSequential) {
+  vector<string> lines = {"DEFINE a 3", "DEFINE b a 2 *", "PUSH 1",
+                          "PUSH 2",     "+",              "PUSH a",
+                          "PUSH 4",     "*",              "PRINT",
+                          "PUSH b",     "SQRT",           "-",
+                          "PRINT",      "/",              "UNKNOWN",
+                          "PUSH 5",     "PUSH 6",         "PUSH 7",
+                          "SUM 2",      "MAX",            "POP",
+                          "POP",        "PRINT"};
+  string expected = runScript(lines, 0);
+
+  ASSERT_EQ(runScript(lines, 4), expected);
+  ASSERT_NE(expected.find("Error: Pop from an empty stack."), string::npos);
+}
+
+// Test a wide script whose independent products run on several threads
+TEST(ParallelScriptTest, wideScript) {
+  vector<string> lines;
+  for (int i = 1; i <= 3000; i++) {
+    lines.push_back("PUSH " + to_string(i));
+    lines.push_back("PUSH " + to_string(i));
+    lines.push_back("*");
+  }
+  lines.push_back("SUM");
+  lines.push_back("PRINT");
+
+  ASSERT_EQ(runScript(lines, 8), runScript(lines, 0));
+}
+
+// Test a script of large reductions, which are handed to other workers
+TEST(ParallelScriptTest, largeReductions) {
+  vector<string> lines;
+  for (int group = 0; group < 64; group++) {
+    for (int i = 0; i < 100; i++) {
+      lines.push_back("PUSH " + to_string(group * 100 + i));
+    }
+    lines.push_back(group % 2 == 0 ? "SUM 100" : "MAX 100");
+    if (group % 8 == 7) {
+      lines.push_back("SUM 8");
+      lines.push_back("PRINT");
+    }
+  }
+  lines.push_back("SUM");
+  lines.push_back("PRINT");
+
+  ASSERT_EQ(runScript(lines, 4), runScript(lines, 0));
+}
+
+// Test that a fallback after a DEFINE restores the parameters of the context
+TEST(ParallelScriptTest, fallbackRestoresParameters) {
+  vector<string> lines = {"PUSH x", "DEFINE x 2", "DEFINE y x 1 +",
+                          "PUSH y", "PUSH 0", "/",
+                          "PRINT",  "DEFINE x 3", "PUSH y",
+                          "PRINT"};
+  ExecutionContext sequential, parallel;
+  ostringstream sequentialOutput, parallelOutput;
+  sequential.output = sequential.errors = &sequentialOutput;
+  parallel.output = parallel.errors = &parallelOutput;
+  processCommand("DEFINE x 1", sequential);
+  processCommand("DEFINE x 1", parallel);
+  for (const string& line : lines) processCommand(line, sequential);
+  executeScriptParallel(lines, parallel, 4);
+
+  ASSERT_EQ(parallelOutput.str(), sequentialOutput.str());
+  ASSERT_EQ(parallel.operandStack.size(), sequential.operandStack.size());
+  ASSERT_EQ(parallel.operandStack.top(), 4);
+  ASSERT_EQ(parallel.parameterValue("y"), 4);
+  ASSERT_EQ(parallel.governor.getCommandsExecuted(),
+            sequential.governor.getCommandsExecuted());
+  ASSERT_EQ(parallel.lineNumber, sequential.lineNumber);
+}
+
+// Test that a value-dependent error falls back to a sequential run
+TEST(ParallelScriptTest, divisionByZeroFallback) {
+  vector<string> lines = {"DEFINE x 1", "PUSH 1", "PUSH 0", "/",
+                          "PRINT",      "PUSH x", "PRINT"};
+
+  ASSERT_EQ(runScript(lines, 4), runScript(lines, 0));
+}
+
+// ---------------------------------------------------------------
+
+// Test that a snapshot restores the stack and both kinds of parameters
+TEST(SnapshotTest, roundTrip) {
+  ExecutionContext context;
+  processCommand("PUSH 1.5", context);
+  processCommand("PUSH -2", context);
+  processCommand("DEFINE a 3", context);
+  processCommand("DEFINE b a 2 *", context);
+  processCommand("DEFINE c b 1 +", context);
+  context.parameterValue("c");
+  vector<char> snapshot = encodeSnapshot(context, 5);
+
+  ExecutionContext restored;
+  ASSERT_EQ(decodeSnapshot(snapshot.data(), snapshot.size(), restored), 5u);
+  ASSERT_EQ(restored.operandStack.size(), 2u);
+  ASSERT_EQ(restored.operandStack.top(), -2);
+  ASSERT_TRUE(restored.derivedParameters["c"].valid);
+  ASSERT_EQ(restored.parameterValue("c"), 7);
+  restored.defineParameter("a", 10);
+  ASSERT_EQ(restored.parameterValue("c"), 21);
+
+  snapshot.pop_back();
+  ASSERT_THROW(decodeSnapshot(snapshot.data(), snapshot.size(), restored),
+               runtime_error);
+}
+
+// Test writing a snapshot on the writer thread and mapping it back
+TEST(SnapshotTest, writeAndLoad) {
+  const string path = "snapshot_test.bin";
+  ExecutionContext context;
+  processCommand("PUSH 42", context);
+  {
+    SnapshotWriter writer(path);
+    writer.submit(encodeSnapshot(context, 1));
+    writer.flush();
+    ASSERT_TRUE(writer.succeeded());
+  }
+
+  ExecutionContext restored;
+  ASSERT_EQ(loadSnapshot(path, restored), 1u);
+  ASSERT_EQ(restored.operandStack.top(), 42);
+  BasicExecutionContext<Fixed64> fixed;
+  ASSERT_THROW(loadSnapshot(path, fixed), runtime_error);
+  remove(path.c_str());
+}
+
+// ---------------------------------------------------------------
+
+// Test that PRINT results can be written as doubles and mapped back
+TEST(ResultOutputTest, writeAndMap) {
+  const string path = "results_test.bin";
+  ResultWriter results;
+  ASSERT_TRUE(results.open(path));
+  BasicExecutionContext<Fixed64> context;
+  context.results = &results;
+  processCommand("PUSH 1.5", context);
+  processCommand("PRINT", context);
+  for (int i = 0; i < 10000; i++) processCommand("PRINT", context);
+  processCommand("PUSH -0.25", context);
+  processCommand("PRINT", context);
+  ASSERT_TRUE(results.close());
+
+  MappedResults mapped(path);
+  ASSERT_EQ(mapped.size(), 10002u);
+  ASSERT_EQ(mapped[0], 1.5);
+  ASSERT_EQ(mapped[10000], 1.5);
+  ASSERT_EQ(mapped[10001], -0.25);
+  remove(path.c_str());
+}
+
+// Test the line index of results printed by a parallel run
+TEST(ResultOutputTest, lineIndex) {
+  const string path = "results_test.bin";
+  const string indexPath = "results_test.idx";
+  ResultWriter results;
+  ASSERT_TRUE(results.open(path, indexPath));
+  ExecutionContext context;
+  context.results = &results;
+  executeScriptParallel({"PUSH 2", "PUSH 3", "+", "PRINT", "", "PRINT"},
+                        context, 2);
+  ASSERT_TRUE(results.close());
+
+  ifstream index(indexPath, ios::binary);
+  vector<char> bytes{istreambuf_iterator<char>(index),
+                     istreambuf_iterator<char>()};
+  ASSERT_EQ(bytes.size(), kResultHeaderSize + 2 * sizeof(uint64_t));
+  uint64_t lines[2];
+  memcpy(lines, bytes.data() + kResultHeaderSize, sizeof(lines));
+  ASSERT_EQ(lines[0], 4u);
+  ASSERT_EQ(lines[1], 6u);
+  ASSERT_EQ(MappedResults(path)[1], 5);
+  remove(path.c_str());
+  remove(indexPath.c_str());
+}
+
+// ---------------------------------------------------------------
+
+// Number of heap allocations made by the test binary, counted by the
+// replacement operators new below. Every form of new and delete is replaced,
+// so each allocation is freed by a matching function
+static atomic<size_t> allocationCount{0};
+
+static void *countedAllocate(size_t size, size_t alignment) {
+  allocationCount.fetch_add(1, memory_order_relaxed);
+  void *memory = nullptr;
+  if (alignment <= alignof(max_align_t)) {
+    memory = malloc(size == 0 ? 1 : size);
+  } else if (posix_memalign(&memory, alignment, size == 0 ? 1 : size) != 0) {
+    memory = nullptr;
+  }
+  if (memory == nullptr) throw bad_alloc();
+  return memory;
+}
+
+void *operator new(size_t size) {
+  return countedAllocate(size, alignof(max_align_t));
+}
+void *operator new[](size_t size) {
+  return countedAllocate(size, alignof(max_align_t));
+}
+void *operator new(size_t size, align_val_t alignment) {
+  return countedAllocate(size, size_t(alignment));
+}
+void *operator new[](size_t size, align_val_t alignment) {
+  return countedAllocate(size, size_t(alignment));
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete[](void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+void operator delete[](void *memory, size_t) noexcept { free(memory); }
+void operator delete(void *memory, align_val_t) noexcept { free(memory); }
+void operator delete[](void *memory, align_val_t) noexcept { free(memory); }
+void operator delete(void *memory, size_t, align_val_t) noexcept {
+  free(memory);
+}
+void operator delete[](void *memory, size_t, align_val_t) noexcept {
+  free(memory);
+}
+
+// Test that executing typical lines does not allocate once the stack and
+// the parameters have reached their size
+TEST(CommandArenaTest, steadyStateAllocations) {
+  ExecutionContext context;
+  ostream discard(nullptr);
+  context.output = &discard;
+  const vector<string> lines = {
+      "PUSH 1.5", "PUSH x",  "+",    "DEFINE x 2", "PUSH 2",
+      "*",        "PRINT",   "# a comment",        "PUSH 4",
+      "SUM 2",    "SQRT",    "PUSH 3.14159265358979323846",
+      "MAX",      "POP"};
+  for (const string &line : lines) processCommand(line, context);
+
+  size_t before = allocationCount.load();
+  for (int i = 0; i < 1000; i++) {
+    for (const string &line : lines) processCommand(line, context);
+  }
+
+  ASSERT_EQ(allocationCount.load() - before, 0u);
+  ASSERT_TRUE(context.operandStack.empty());
+
+  before = allocationCount.load();
+  processCommand("DEFINE y 1", context);  // A new parameter grows the map
+  ASSERT_GT(allocationCount.load() - before, 0u);
+}
+
+// Test that a line larger than the initial arena buffer still works
+TEST(CommandArenaTest, longLine) {
+  ExecutionContext context;
+  string line = "DEFINE total";
+  for (int i = 0; i < 1000; i++) line += i == 0 ? " 1" : " 1 +";
+  processCommand(line, context);
+  processCommand("PUSH total", context);
+
+  ASSERT_EQ(context.operandStack.top(), 1000);
+}
+
+// ---------------------------------------------------------------
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
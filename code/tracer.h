@@ -0,0 +1,144 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Tracer records how long the phases of the calculator take (reading a line,
+// tokenizing it, creating and executing the command) and writes them in the
+// Chrome trace-event format, which can be opened in Perfetto or
+// about:tracing. Only every sampleEvery-th line is recorded, so the overhead
+// stays bounded. Each thread gets its own lane in the timeline
+class Tracer {
+ public:
+  explicit Tracer(size_t sampleEvery = 1)
+      : sampleEvery(sampleEvery == 0 ? 1 : sampleEvery),
+        start(chrono::steady_clock::now()) {}
+
+  // Function to start a new input line on the calling thread. Returns
+  // whether the spans of the line are recorded
+  bool beginLine() {
+    size_t line = lines.fetch_add(1, memory_order_relaxed);
+    sampledLine() = line % sampleEvery == 0;
+    return sampledLine();
+  }
+
+  // Whether the line the calling thread works on is recorded
+  bool sampling() const { return sampledLine(); }
+
+  // Function to record a finished span
+  void record(const char* name, chrono::steady_clock::time_point begin,
+              chrono::steady_clock::time_point end) {
+    int lane = threadLane();
+    lock_guard<mutex> lock(eventsMutex);
+    events.push_back({name, begin, end, lane});
+  }
+
+  size_t getEventCount() const {
+    lock_guard<mutex> lock(eventsMutex);
+    return events.size();
+  }
+
+  // Function to write the recorded spans as trace-event JSON
+  void write(ostream& out) const {
+    lock_guard<mutex> lock(eventsMutex);
+    out << "{\"traceEvents\":[";
+    int lanes = 0;
+    for (const Event& event : events) lanes = max(lanes, event.lane + 1);
+    for (int lane = 0; lane < lanes; lane++) {
+      out << (lane == 0 ? "" : ",")
+          << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+          << lane << ",\"args\":{\"name\":\"thread " << lane << "\"}}";
+    }
+    out << fixed << setprecision(3);
+    for (const Event& event : events) {
+      out << ",\n{\"name\":\"" << event.name
+          << "\",\"cat\":\"calculator\",\"ph\":\"X\",\"ts\":"
+          << microseconds(event.begin - start)
+          << ",\"dur\":" << microseconds(event.end - event.begin)
+          << ",\"pid\":1,\"tid\":" << event.lane << "}";
+    }
+    out << "\n]}\n";
+    out << defaultfloat;
+  }
+
+  // Function to write the recorded spans to a file
+  bool writeFile(const string& path) const {
+    ofstream file(path);
+    if (!file.is_open()) {
+      cerr << "Error: Unable to open file " << path << endl;
+      return false;
+    }
+    write(file);
+    return true;
+  }
+
+ private:
+  struct Event {
+    const char* name;
+    chrono::steady_clock::time_point begin;
+    chrono::steady_clock::time_point end;
+    int lane;
+  };
+
+  size_t sampleEvery;
+  chrono::steady_clock::time_point start;
+  atomic<size_t> lines{0};
+  atomic<int> nextLane{0};
+  mutable mutex eventsMutex;
+  vector<Event> events;
+
+  static bool& sampledLine() {
+    static thread_local bool sampled = false;
+    return sampled;
+  }
+
+  // Function to get the timeline lane of the calling thread
+  int threadLane() {
+    static thread_local const Tracer* owner = nullptr;
+    static thread_local int lane = 0;
+    if (owner != this) {
+      owner = this;
+      lane = nextLane.fetch_add(1, memory_order_relaxed);
+    }
+    return lane;
+  }
+
+  static double microseconds(chrono::steady_clock::duration duration) {
+    return chrono::duration<double, micro>(duration).count();
+  }
+};
+
+// TraceSpan records the time from its construction to end() or its
+// destruction, if there is a tracer and the current line is sampled
+class TraceSpan {
+ public:
+  TraceSpan(Tracer* tracer, const char* name)
+      : tracer(tracer != nullptr && tracer->sampling() ? tracer : nullptr),
+        name(name) {
+    if (this->tracer != nullptr) begin = chrono::steady_clock::now();
+  }
+
+  ~TraceSpan() { end(); }
+
+  void end() {
+    if (tracer == nullptr) return;
+    tracer->record(name, begin, chrono::steady_clock::now());
+    tracer = nullptr;
+  }
+
+ private:
+  Tracer* tracer;
+  const char* name;
+  chrono::steady_clock::time_point begin;
+};
+
+#endif